@@ -0,0 +1,34 @@
+
+/*
+    Copyright (c) 2020 Kristjan Kongas
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+    REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+    AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+    INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+    LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+    OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+    PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include <iostream>
+#include "../fire.hpp"
+
+using namespace std;
+
+int add(int x = fire::arg("-x"), int y = fire::arg("-y")) {
+    cout << x + y << endl;
+    return 0;
+}
+
+int opposite(int x = fire::arg({0, "<x>"})) {
+    cout << -x << endl;
+    return 0;
+}
+
+FIRE_SUBCOMMAND(add)
+FIRE_SUBCOMMAND_NO_SPACE_ASSIGNMENT(opposite)
+FIRE_SUBCOMMANDS()
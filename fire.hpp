@@ -38,23 +38,100 @@
 #include <map>
 #include <unordered_map>
 #include <unordered_set>
+#include <deque>
 #include <cassert>
 #include <cstdlib>
 #include <cstddef>
 #include <algorithm>
 #include <type_traits>
 #include <limits>
+#include <fstream>
+#include <iterator>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define FIRE_POSIX_
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <glob.h>
+#endif
+
+#ifndef _WIN32
+extern char **environ;
+#endif
 
 
 namespace fire {
     constexpr int _failure_code = 1;
+    constexpr int _max_response_file_depth = 16;
+    constexpr size_t _stdin_chunk_size = 1 << 16;
+    constexpr size_t _max_value_file_size = (size_t) 1 << 30;
+#ifdef FIRE_RESPONSE_FILES
+    constexpr bool _response_files = true; // Programs opt in to expanding @path arguments
+#else
+    constexpr bool _response_files = false;
+#endif
+#ifdef FIRE_RESPONSE_FILE_CACHE
+    constexpr bool _response_file_cache = true; // Tokens of large response files are kept in "path.fire-cache"
+#else
+    constexpr bool _response_file_cache = false;
+#endif
+    constexpr size_t _min_cached_response_file = 1 << 16; // Smaller files are tokenized faster than a cache is opened
 
     template<typename R, typename ... Types>
     constexpr size_t _get_argument_count(R(*)(Types ...)) { return sizeof...(Types); }
 
     inline void _instant_assert(bool pass, const std::string &msg, bool programmer_side = true);
     inline int count_hyphens(const std::string &s);
+    inline bool _may_take_value(const std::string &s);
     inline std::string without_hyphens(const std::string &s);
+    template <typename T>
+    std::string _type_name() { return std::is_integral<T>::value ? "INTEGER" : std::is_floating_point<T>::value ? "REAL" : "STRING"; }
+    template <typename T, typename std::enable_if<std::is_integral<T>::value>::type* = nullptr>
+    inline std::pair<std::string, std::string> _limits();
+    template <typename T, typename std::enable_if<std::is_floating_point<T>::value>::type* = nullptr>
+    inline std::pair<std::string, std::string> _limits();
+    inline bool _read_file(const std::string &path, std::string &contents,
+                           size_t max_size = std::numeric_limits<size_t>::max(), bool *too_large = nullptr);
+    inline std::vector<std::string> _split_arguments(const char *begin, const char *end);
+    inline std::vector<std::string> _split_arguments(const std::string &text);
+    inline bool _read_response_file(const std::string &path, std::vector<std::string> &args, bool cache);
+    template <typename T>
+    inline void _reserve_more(std::vector<T> &v, size_t n);
+
+    enum class advice { normal, sequential, random, willneed, dontneed }; // Access pattern hints for mapped files
+
+    class _file_view { // Read-only contents of a file, memory-mapped where supported
+        const char *_data = nullptr;
+        size_t _size = 0;
+        bool _valid = false;
+        bool _mapped = false;
+        bool _too_large = false;
+        std::string _buffer; // Contents if the file couldn't be mapped
+        std::string _error;
+
+    public:
+        inline explicit _file_view(const std::string &path, size_t max_size = std::numeric_limits<size_t>::max());
+        inline ~_file_view();
+        _file_view(const _file_view &) = delete;
+        _file_view & operator=(const _file_view &) = delete;
+
+        inline bool valid() const { return _valid; }
+        inline bool too_large() const { return _too_large; } // Larger than max_size, so it wasn't read
+        inline const std::string & error() const { return _error; }
+        inline const char * data() const { return _data; }
+        inline size_t size() const { return _size; }
+        inline bool advise(advice hint) const;
+    };
 
     template <typename T>
     class optional {
@@ -74,7 +151,7 @@ namespace fire {
 
     class identifier {
         optional<int> _pos;
-        optional<std::string> _short_name, _long_name, _pos_name, _descr;
+        optional<std::string> _short_name, _long_name, _pos_name, _env, _descr;
         bool _vector = false;
         bool _optional = false; // Only use for operator<
 
@@ -91,12 +168,16 @@ namespace fire {
         inline bool overlaps(const identifier &other) const;
         inline bool contains(const std::string &name) const;
         inline bool contains(int pos) const;
-        inline std::string help() const { return _help; }
-        inline std::string longer() const { return _longer; }
+        inline const std::string & help() const { return _help; }
+        inline const std::string & longer() const { return _longer; }
         inline optional<int> get_pos() const { return _pos; }
         inline void set_optional(bool optional) { _optional = optional; }
         inline bool vector() const { return _vector; }
 
+        inline optional<std::string> get_short_name() const { return _short_name; }
+        inline optional<std::string> get_long_name() const { return _long_name; }
+        inline optional<std::string> get_pos_name() const { return _pos_name; }
+        inline optional<std::string> get_env() const { return _env; }
         inline std::string get_descr() const { return _descr.value_or(""); }
     };
 
@@ -112,38 +193,100 @@ namespace fire {
         bool empty() const { return _empty; }
     };
 
+    struct _shard { // Slice of vector items processed by this job, from --fire-shard=INDEX/COUNT[:MODE]
+        enum class mode { contiguous, strided, hash };
+
+        size_t index = 0, count = 1;
+        mode selection = mode::contiguous;
+
+        inline static optional<_shard> parse(const std::string &spec);
+    };
+
     class _matcher {
         std::string _executable;
         std::vector<std::string> _positional;
         std::vector<std::pair<std::string, optional<std::string>>> _named;
-        std::vector<identifier> _queried;
+        std::unordered_map<std::string, size_t> _named_index; // Position of each name in _named
+        std::vector<std::string> _repeated_names; // Given more than once, which is fine only if forwarded
+        std::unordered_set<std::string> _queried_names; // Names and positions of queried arguments (strict mode)
+        std::unordered_set<int> _queried_positions;
+
+        enum class _token_role { named, value, positional, separator };
+        struct _token { // Command line token in original order, for forwarding unconsumed arguments
+            const char *text; // Original argv entry, or nullptr for expanded positional arguments
+            _token_role role;
+            size_t pos;
+        };
+        std::vector<_token> _tokens;
+        std::deque<std::string> _expanded_named; // Stable copies of named tokens from response files
+        std::shared_ptr<std::vector<const char *>> _rest;
+        std::shared_ptr<std::deque<std::string>> _rest_copies; // Owned by fire::rest if _copy_rest is set
+        std::unordered_set<std::string> _forwarded_named;
+        std::unordered_set<size_t> _forwarded_positional;
         _first<identifier, std::string> _deferred_error;
         int _main_argc = 0;
         bool _space_assignment = false;
         bool _strict = false;
+        bool _response_files = false; // Arguments "@path" are replaced by the arguments in file path
         bool _help_flag = false;
+        optional<std::string> _completion_shell;
+        bool _schema_flag = false;
+        optional<_shard> _shard_spec;
+        bool _shard_resolved = false; // --fire-shard was given or $FIRE_SHARD has been read
+        bool _shard_given = false; // --fire-shard is valid only if a vector uses it
+        bool _copy_rest = false; // Forwarded arguments outlive the command line, so they're copied
+        bool _completing = false; // Answering --fire-complete, so arguments aren't parsed or converted
+        size_t _complete_index = 0;
+        std::vector<std::string> _complete_words;
+        bool _checked = false; // Final check has passed, so later errors can't be deferred
+        bool _structure_checked = false; // Unknown and unused arguments have been looked for
+        bool _all_positional_queried = false;
+        std::unordered_map<std::string, std::string> _environment;
+        bool _environment_indexed = false;
 
     public:
         enum class arg_type { string_t, bool_t, none_t };
 
         inline _matcher() = default;
-        inline _matcher(int argc, const char **argv, int main_argc, bool space_assignment, bool strict);
+        inline _matcher(int argc, const char **argv, int main_argc, bool space_assignment, bool strict,
+                        bool response_files = false);
 
         inline void check(bool dec_main_argc);
+        inline void check_structure();
+        inline void check_before_last();
+        inline void fail_fast();
+        inline void exit_on_error();
         inline void check_named();
         inline void check_positional();
+        inline void collect_rest();
+        inline void set_rest(const identifier &id, std::shared_ptr<std::vector<const char *>> rest,
+                             std::shared_ptr<std::deque<std::string>> copies);
+        inline bool is_queried(const std::string &name) const;
 
         inline std::pair<std::string, arg_type> get_and_mark_as_queried(const identifier &id);
+        inline void mark_all_positional_as_queried(const identifier &id);
+        inline const std::string * get_environment(const std::string &name);
         inline void parse(int argc, const char **argv);
+        inline void parse_reserved();
+        inline void read_config(const std::string &path);
         inline std::vector<std::string> to_vector_string(int n_strings, const char **strings);
+        inline void expand_response_files(std::vector<std::string> raw, std::vector<std::string> &expanded,
+                                          bool &positional_only, int depth = 0, const char **origin = nullptr);
+        inline void read_argv_fd(const std::string &fd_string, std::vector<std::string> &expanded);
         inline std::tuple<std::vector<std::string>, std::vector<std::string>>
-                separate_named_positional(const std::vector<std::string> &raw);
+                separate_named_positional(std::vector<std::string> raw);
         inline std::vector<std::pair<std::string, bool>> split_equations(const std::vector<std::string> &named);
         inline std::vector<std::pair<std::string, optional<std::string>>>
                 assign_named_values(const std::vector<std::pair<std::string, bool>> &split);
         inline const std::string& get_executable() { return _executable; }
         inline size_t pos_args() { return _positional.size(); }
+        inline const std::string& get_positional(size_t pos) { return _positional[pos]; }
         inline bool deferred_assert(const identifier &id, bool pass, const std::string &msg);
+        inline optional<std::string> deferred_error() const;
+        inline bool info_requested() const;
+        inline bool skip_conversions() const;
+        inline const optional<_shard> & shard();
+        inline void isolate() { _shard_resolved = _copy_rest = true; } // Command line isn't the process's own
     };
 
 
@@ -154,6 +297,10 @@ namespace fire {
             std::string type;
             std::string def;
             bool optional;
+            std::string element_type; // Type of vector elements
+            bool rest; // Unconsumed arguments (fire::rest), named or positional
+            std::string source; // Where vector items come from: "positional", "stdin" or "paths"
+            std::string min, max; // Range of the numeric type the program converts to
         };
 
     private:
@@ -162,8 +309,25 @@ namespace fire {
         inline std::string _make_printable(const identifier &id, const log_elem &elem, bool verbose);
         inline void _add_to_help(std::string &usage, std::string &options,
                                  const identifier &id, const log_elem &elem, size_t margin);
+        inline static std::vector<std::string> _names(const identifier &id);
+        inline static std::string _program_name(const std::string &executable);
+        inline std::vector<std::pair<identifier, log_elem>> _params_with_help();
+        inline static std::string _function_name(const std::string &command);
+        inline static bool _completes_files(const std::vector<std::pair<identifier, log_elem>> &params);
+        inline static std::string _bash_function(const std::string &function,
+                                                 const std::vector<std::pair<identifier, log_elem>> &params, bool files);
+        inline static std::string _zsh_function(const std::string &function,
+                                                const std::vector<std::pair<identifier, log_elem>> &params);
+        inline static std::string _fish_completion(const std::string &command, const std::string &condition,
+                                                   const std::vector<std::pair<identifier, log_elem>> &params, bool files);
     public:
         inline void print_help();
+        inline static void check_shell(const std::string &shell);
+        inline std::string completion(const std::string &shell);
+        inline static std::string completion(const std::string &shell, const std::string &executable,
+                                             std::vector<std::pair<std::string, _help_logger>> &commands);
+        inline std::string schema(bool space_assignment, bool response_files);
+        inline std::vector<std::string> complete(size_t index, const std::vector<std::string> &words, bool space_assignment);
         inline void log(const identifier &name, const log_elem &elem);
     };
 
@@ -171,6 +335,12 @@ namespace fire {
     struct _storage {
         static _matcher matcher;
         static _help_logger help_logger;
+        static thread_local _matcher *isolated_matcher; // Set by _isolated_parse for the current thread
+        static thread_local _help_logger *isolated_logger;
+        static bool declarations_only; // Commands stop once their arguments are declared, see _subcommands::completion
+
+        inline static _matcher & current_matcher() { return isolated_matcher ? *isolated_matcher : matcher; }
+        inline static _help_logger & current_logger() { return isolated_logger ? *isolated_logger : help_logger; }
     };
 
     template <typename T_VOID>
@@ -179,28 +349,181 @@ namespace fire {
     template <typename T_VOID>
     _help_logger _storage<T_VOID>::help_logger;
 
+    template <typename T_VOID>
+    thread_local _matcher *_storage<T_VOID>::isolated_matcher = nullptr;
+
+    template <typename T_VOID>
+    thread_local _help_logger *_storage<T_VOID>::isolated_logger = nullptr;
+
+    template <typename T_VOID>
+    bool _storage<T_VOID>::declarations_only = false;
+
+    struct _declared {}; // Thrown instead of printing a completion script while declarations_only is set
+
     using _ = _storage<void>;
 
+    class _isolated_parse { // Converts arguments from a custom command line, leaving the program's own matcher intact
+        _matcher _matcher_instance; // Used by conversions on this thread only, so isolated parses can run concurrently
+        _help_logger _logger_instance;
+        _matcher *_outer_matcher;
+        _help_logger *_outer_logger;
+
+    public:
+        inline _isolated_parse(const std::string &executable, const std::vector<std::string> &args, bool space_assignment);
+        _isolated_parse(const _isolated_parse &) = delete;
+        _isolated_parse & operator=(const _isolated_parse &) = delete;
+        inline ~_isolated_parse();
+        inline optional<std::string> finish();
+    };
+
+    class _item_source { // Produces positional items one at a time
+    public:
+        virtual ~_item_source() = default;
+        virtual bool next(std::string &item) = 0;
+    };
+
+    class _stdin_source: public _item_source { // Delimited items from stdin, read in fixed-size chunks
+        std::vector<char> _chunk;
+        size_t _begin = 0, _end = 0;
+        char _delimiter;
+
+    public:
+        inline explicit _stdin_source(char delimiter): _chunk(_stdin_chunk_size), _delimiter(delimiter) {}
+        inline bool next(std::string &item) override;
+    };
+
+    class _empty_source: public _item_source { // No items, for vectors whose conversion is skipped
+    public:
+        inline bool next(std::string &) override { return false; }
+    };
+
+    class _positional_source: public _item_source { // Positional items from command line
+        size_t _next = 0;
+
+    public:
+        inline bool next(std::string &item) override;
+    };
+
+    class _shard_source: public _item_source { // Items of another source that belong to the shard
+        std::shared_ptr<_item_source> _base;
+        _shard _spec;
+        size_t _next = 0, _begin = 0, _end = 0;
+
+    public:
+        inline _shard_source(std::shared_ptr<_item_source> base, const _shard &spec, size_t total);
+        inline bool next(std::string &item) override;
+    };
+
+    class _path_source: public _item_source { // Items of another source with glob patterns and directories expanded
+        enum class kind { unknown, file, directory };
+
+        std::shared_ptr<_item_source> _base;
+        std::vector<std::pair<std::string, kind>> _pending; // Depth-first stack, next item at the back
+
+        inline void _push_pattern(const std::string &pattern);
+        inline void _push_directory(const std::string &directory);
+
+    public:
+        inline explicit _path_source(std::shared_ptr<_item_source> base): _base(std::move(base)) {}
+        inline bool next(std::string &item) override;
+    };
+
+    class rest { // Unconsumed command line arguments in their original order, null-terminated for execv
+        std::shared_ptr<std::vector<const char *>> _args = std::make_shared<std::vector<const char *>>(1, nullptr);
+        std::shared_ptr<std::deque<std::string>> _copies = std::make_shared<std::deque<std::string>>();
+
+        friend class arg;
+
+    public:
+        rest() = default;
+
+        size_t size() const { return _args->size() - 1; }
+        bool empty() const { return size() == 0; }
+        const char * operator[](size_t i) const { return (*_args)[i]; }
+        const char * const * begin() const { return _args->data(); }
+        const char * const * end() const { return _args->data() + size(); }
+        char * const * argv() const { return const_cast<char * const *>(_args->data()); }
+    };
+
+    class string_ref { // Read-only string value, which may be memory-mapped from a file
+        std::shared_ptr<const _file_view> _file;
+        std::shared_ptr<const std::string> _owned;
+        const char *_data = "";
+        size_t _size = 0;
+
+        friend class arg;
+        inline static string_ref _owning(std::string value);
+        inline static string_ref _mapped(std::shared_ptr<const _file_view> file);
+
+    public:
+        string_ref() = default;
+
+        const char * data() const { return _data; }
+        size_t size() const { return _size; }
+        bool empty() const { return _size == 0; }
+        const char * begin() const { return _data; }
+        const char * end() const { return _data + _size; }
+        std::string str() const { return std::string(_data, _size); }
+#if __cplusplus >= 201703L
+        operator std::string_view() const { return std::string_view(_data, _size); }
+#endif
+    };
+
+    class mapped_file { // Read-only contents of an input file given by path, memory-mapped where supported
+        std::shared_ptr<const _file_view> _file;
+        std::string _path;
+
+        friend class arg;
+
+    public:
+        mapped_file() = default;
+
+        const std::string & path() const { return _path; }
+        const char * data() const { return _file ? _file->data() : ""; }
+        size_t size() const { return _file ? _file->size() : 0; }
+        bool empty() const { return size() == 0; }
+        const char * begin() const { return data(); }
+        const char * end() const { return data() + size(); }
+        bool advise(advice hint) const { return _file && _file->advise(hint); }
+#if __cplusplus >= 201703L
+        operator std::string_view() const { return std::string_view(data(), size()); }
+#endif
+    };
+
+    template <typename T>
+    class stream;
+
     class arg {
+        template <typename T> friend class stream;
+        friend class validator;
+        friend class argv_builder;
+
         identifier _id; // No identifier implies vector positional arguments
 
         optional<long long> _int_value;
         optional<long double> _float_value;
         optional<std::string> _string_value;
+        optional<char> _stdin_delimiter; // Positional items are read from stdin instead of command line
+        bool _expand_paths = false; // Positional glob patterns and directories are expanded to file paths
+
+        using _elem = std::pair<std::string, _matcher::arg_type>;
 
         template <typename T>
-        optional<T> _get() { T::unimplemented_function; } // no default function
+        optional<T> _get(const _elem &) { T::unimplemented_function; } // no default function
 
         template <typename T, typename std::enable_if<std::is_integral<T>::value && ! std::is_same<T, bool>::value>::type* = nullptr>
-        optional<T> _get_with_precision();
+        optional<T> _get_with_precision(const _elem &elem);
         template <typename T, typename std::enable_if<std::is_floating_point<T>::value>::type* = nullptr>
-        optional<T> _get_with_precision();
+        optional<T> _get_with_precision(const _elem &elem);
         template <typename T, typename std::enable_if<std::is_same<T, bool>::value || std::is_same<T, std::string>::value, bool>::type* = nullptr>
-        optional<T> _get_with_precision() { return _get<T>(); }
+        optional<T> _get_with_precision(const _elem &elem) { return _get<T>(elem); }
 
         template <typename T> optional<T> _convert_optional(bool dec_main_argc=true);
         template <typename T> T _convert(bool dec_main_argc=true);
-        inline void _log(const std::string &type, bool optional);
+        template <typename T> T _convert_value(const std::string &value);
+        inline std::shared_ptr<_item_source> _item_source_for_vector();
+        inline void _log(const std::string &type, bool optional, const std::string &element_type = "", bool rest = false,
+                         const std::pair<std::string, std::string> &limits = {});
 
         template <typename T, typename std::enable_if<std::is_integral<T>::value>::type* = nullptr>
         inline void init_default(T value) { _int_value = value; }
@@ -240,22 +563,83 @@ namespace fire {
             arg({_id}, value) {}
 
         inline static arg vector(std::string _descr = "");
+        inline static arg stdin_vector(std::string _descr = "", char delimiter = '\n');
+        inline static arg path_vector(std::string _descr = "");
+        inline static arg unconsumed(std::string _descr = "");
 
         template <typename T, typename std::enable_if<std::is_integral<T>::value>::type* = nullptr>
-        inline operator optional<T>() { _log("INTEGER", true); return _convert_optional<T>(); }
+        inline operator optional<T>() { _log("INTEGER", true, "", false, _limits<T>()); return _convert_optional<T>(); }
         template <typename T, typename std::enable_if<std::is_floating_point<T>::value>::type* = nullptr>
-        inline operator optional<T>() { _log("REAL", true); return _convert_optional<T>(); }
+        inline operator optional<T>() { _log("REAL", true, "", false, _limits<T>()); return _convert_optional<T>(); }
         inline operator optional<std::string>() { _log("STRING", true); return _convert_optional<std::string>(); }
 
         template <typename T, typename std::enable_if<std::is_integral<T>::value>::type* = nullptr>
-        inline operator T() { _log("INTEGER", false); return _convert<T>(); }
+        inline operator T() { _log("INTEGER", false, "", false, _limits<T>()); return _convert<T>(); }
         template <typename T, typename std::enable_if<std::is_floating_point<T>::value>::type* = nullptr>
-        inline operator T() { _log("REAL", false); return _convert<T>(); }
+        inline operator T() { _log("REAL", false, "", false, _limits<T>()); return _convert<T>(); }
         inline operator std::string() { _log("STRING", false); return _convert<std::string>(); }
+        inline operator string_ref();
+        inline operator mapped_file();
+        inline operator rest();
         inline operator bool();
 
         template <typename T>
         inline operator std::vector<T>();
+        template <typename T>
+        inline operator stream<T>();
+    };
+
+    template <typename T>
+    class stream { // Single-pass range of positional items, each converted to T only when reached
+        arg _arg;
+        std::shared_ptr<_item_source> _source;
+
+        friend class arg;
+        stream(arg a, std::shared_ptr<_item_source> source): _arg(std::move(a)), _source(std::move(source)) {}
+
+    public:
+        class iterator {
+            stream *_stream = nullptr;
+            T _value = T();
+
+        public:
+            using iterator_category = std::input_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const T *;
+            using reference = const T &;
+
+            iterator() = default;
+            explicit iterator(stream *s): _stream(s) { ++*this; }
+
+            const T & operator*() const { return _value; }
+            const T * operator->() const { return &_value; }
+            inline iterator & operator++();
+            bool operator==(const iterator &other) const { return _stream == other._stream; }
+            bool operator!=(const iterator &other) const { return _stream != other._stream; }
+        };
+
+        iterator begin() { return iterator(this); }
+        iterator end() { return iterator(); }
+    };
+
+    template <typename T>
+    class reloadable { // Immutable snapshot of options parsed from a file, republished by reload()
+        std::string _path, _contents;
+        std::function<T()> _parse;
+        bool _space_assignment;
+        size_t _retained;
+        std::atomic<const T *> _current;
+        std::deque<std::unique_ptr<const T>> _snapshots; // Most recent ones, as readers may still use them
+
+        inline bool _publish(const std::string &contents, std::string &error);
+    public:
+        inline reloadable(std::string path, std::function<T()> parse, bool space_assignment = true, size_t retained = 8);
+        reloadable(const reloadable &) = delete;
+        reloadable & operator=(const reloadable &) = delete;
+
+        inline bool reload();
+        inline const T & get() const { return *_current.load(std::memory_order_acquire); }
     };
 
     void _instant_assert(bool pass, const std::string &msg, bool programmer_side) {
@@ -279,6 +663,13 @@ namespace fire {
         return hyphens;
     }
 
+    bool _may_take_value(const std::string &s) { // "--name" or "-n", whose value may follow with space assignment
+        int hyphens = count_hyphens(s);
+        int name_size = (int) s.size() - hyphens;
+        bool named = hyphens == 2 || (hyphens == 1 && name_size == 1 && ! isdigit(s[1]));
+        return named && name_size >= 1 && s.find('=') == std::string::npos;
+    }
+
     std::string without_hyphens(const std::string &s) {
         int hyphens = count_hyphens(s);
         std::string wo_hyphens = s.substr(hyphens);
@@ -286,6 +677,261 @@ namespace fire {
     }
 
 
+    bool _read_file(const std::string &path, std::string &contents, size_t max_size, bool *too_large) {
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        if(! file)
+            return false;
+
+        std::streamoff size = file.seekg(0, std::ios::end).tellg();
+        if(size < 0) { // Not seekable, eg. a pipe, so reading stops at the limit
+            file.clear();
+            contents.clear();
+            char chunk[1 << 14];
+            while(file.read(chunk, sizeof(chunk)), file.gcount() > 0) {
+                size_t count = (size_t) file.gcount();
+                if(count > max_size - contents.size()) {
+                    if(too_large)
+                        *too_large = true;
+                    return false;
+                }
+                contents.append(chunk, count);
+            }
+            return ! file.bad();
+        }
+        if((unsigned long long) size > max_size) {
+            if(too_large)
+                *too_large = true;
+            return false;
+        }
+
+        contents.resize((size_t) size);
+        file.seekg(0, std::ios::beg);
+        file.read(&contents[0], size);
+        return file.gcount() == size;
+    }
+
+    std::vector<std::string> _split_arguments(const char *begin, const char *end) {
+        auto is_space = [](char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }; // As isspace in the C locale
+        auto is_quote = [](char c) { return c == '"' || c == '\''; };
+
+        std::vector<std::string> args;
+        const char *it = begin;
+        while(true) {
+            it = std::find_if_not(it, end, is_space);
+            if(it == end)
+                break;
+
+            const char *start = it;
+            it = std::find_if(it, end, [&](char c) { return is_space(c) || is_quote(c); });
+            if(it == end || is_space(*it)) { // Unquoted arguments are constructed directly from the input
+                args.emplace_back(start, it);
+                continue;
+            }
+
+            std::string arg(start, it);
+            while(it != end && ! is_space(*it)) {
+                if(is_quote(*it)) { // Everything up to the closing quote belongs to the argument
+                    const char *close = std::find(it + 1, end, *it);
+                    arg.append(it + 1, close);
+                    it = close == end ? end : close + 1;
+                } else
+                    arg += *it++;
+            }
+            args.push_back(std::move(arg));
+        }
+        return args;
+    }
+
+    std::vector<std::string> _split_arguments(const std::string &text) {
+        return _split_arguments(text.data(), text.data() + text.size());
+    }
+
+#ifdef FIRE_POSIX_
+    struct _token_cache_header { // Followed by (offset, length) of each token and then the token bytes
+        char magic[8];
+        uint64_t source_size;
+        int64_t mtime_sec, mtime_nsec; // Cache is valid only for the response file with this size and mtime
+        uint64_t count;
+    };
+
+    inline int64_t _mtime_nsec(const struct stat &st) {
+#ifdef __APPLE__
+        return (int64_t) st.st_mtimespec.tv_nsec;
+#else
+        return (int64_t) st.st_mtim.tv_nsec;
+#endif
+    }
+
+    inline bool _read_token_cache(const std::string &path, const struct stat &source, std::vector<std::string> &args) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if(fd < 0)
+            return false;
+        struct stat st;
+        bool sized = fstat(fd, &st) == 0 && (size_t) st.st_size >= sizeof(_token_cache_header);
+        void *mapped = sized ? mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        close(fd);
+        if(mapped == MAP_FAILED)
+            return false;
+
+        const char *data = (const char *) mapped;
+        size_t size = (size_t) st.st_size;
+        _token_cache_header header;
+        std::memcpy(&header, data, sizeof(header));
+        size_t table = sizeof(header), entries = (size - table) / (2 * sizeof(uint64_t));
+        bool valid = std::memcmp(header.magic, "FIRETOK1", 8) == 0 && header.source_size == (uint64_t) source.st_size &&
+                     header.mtime_sec == (int64_t) source.st_mtime && header.mtime_nsec == _mtime_nsec(source) &&
+                     header.count <= entries;
+        if(valid) {
+            size_t blob = table + 2 * sizeof(uint64_t) * (size_t) header.count, blob_size = size - blob;
+            args.clear();
+            args.reserve((size_t) header.count);
+            for(size_t i = 0; valid && i < header.count; ++i) {
+                uint64_t entry[2];
+                std::memcpy(entry, data + table + i * sizeof(entry), sizeof(entry));
+                valid = entry[0] <= blob_size && entry[1] <= blob_size - entry[0];
+                if(valid)
+                    args.emplace_back(data + blob + entry[0], (size_t) entry[1]);
+            }
+        }
+        munmap(mapped, size);
+        return valid;
+    }
+
+    inline void _write_token_cache(const std::string &path, const struct stat &source, const std::vector<std::string> &args) {
+        _token_cache_header header;
+        std::memcpy(header.magic, "FIRETOK1", 8);
+        header.source_size = (uint64_t) source.st_size;
+        header.mtime_sec = (int64_t) source.st_mtime;
+        header.mtime_nsec = _mtime_nsec(source);
+        header.count = args.size();
+
+        std::string data((const char *) &header, sizeof(header));
+        uint64_t offset = 0;
+        for(const std::string &arg: args) {
+            uint64_t entry[2] = {offset, arg.size()};
+            data.append((const char *) entry, sizeof(entry));
+            offset += arg.size();
+        }
+        for(const std::string &arg: args)
+            data += arg;
+
+        std::string temporary = path + ".tmp" + std::to_string(getpid()); // Readers never see a partial cache
+        int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if(fd < 0)
+            return; // Cache is an optimization, so failures are ignored
+        size_t written = 0;
+        ssize_t count = 0;
+        while(written < data.size() && (count = write(fd, data.data() + written, data.size() - written)) > 0)
+            written += (size_t) count;
+        bool complete = close(fd) == 0 && written == data.size();
+        if(! complete || rename(temporary.c_str(), path.c_str()) != 0)
+            unlink(temporary.c_str());
+    }
+#endif
+
+    bool _read_response_file(const std::string &path, std::vector<std::string> &args, bool cache) {
+#ifdef FIRE_POSIX_
+        struct stat source;
+        cache = cache && stat(path.c_str(), &source) == 0 && S_ISREG(source.st_mode) &&
+                (size_t) source.st_size >= _min_cached_response_file;
+        if(cache && _read_token_cache(path + ".fire-cache", source, args))
+            return true;
+#else
+        (void) cache;
+#endif
+        _file_view file(path);
+        if(! file.valid())
+            return false;
+        args = _split_arguments(file.data(), file.data() + file.size());
+#ifdef FIRE_POSIX_
+        if(cache)
+            _write_token_cache(path + ".fire-cache", source, args);
+#endif
+        return true;
+    }
+
+    template <typename T, typename std::enable_if<std::is_integral<T>::value>::type*>
+    std::pair<std::string, std::string> _limits() { // Range of a parameter type, as exported in schemas
+        return {std::to_string(std::numeric_limits<T>::lowest()), std::to_string(std::numeric_limits<T>::max())};
+    }
+
+    template <typename T, typename std::enable_if<std::is_floating_point<T>::value>::type*>
+    std::pair<std::string, std::string> _limits() {
+        char min[64], max[64]; // Enough digits to read back the exact limits as long double
+        int digits = std::numeric_limits<long double>::max_digits10;
+        std::snprintf(min, sizeof(min), "%.*Lg", digits, (long double) std::numeric_limits<T>::lowest());
+        std::snprintf(max, sizeof(max), "%.*Lg", digits, (long double) std::numeric_limits<T>::max());
+        return {min, max};
+    }
+
+    template <typename T>
+    void _reserve_more(std::vector<T> &v, size_t n) { // Keeps geometric growth when called for many small files
+        if(v.capacity() < v.size() + n)
+            v.reserve(std::max(v.size() + n, 2 * v.capacity()));
+    }
+
+
+    _file_view::_file_view(const std::string &path, size_t max_size) {
+#ifdef FIRE_POSIX_
+        int fd = open(path.c_str(), O_RDONLY);
+        if(fd < 0) {
+            _error = std::strerror(errno);
+            return;
+        }
+
+        struct stat st;
+        bool has_status = fstat(fd, &st) == 0;
+        if(has_status && S_ISDIR(st.st_mode)) {
+            _error = std::strerror(EISDIR);
+            close(fd);
+            return;
+        }
+        if(has_status && S_ISREG(st.st_mode) && (unsigned long long) st.st_size > max_size) { // Refused before mapping
+            _too_large = true;
+            _error = std::strerror(EFBIG);
+            close(fd);
+            return;
+        }
+        if(has_status && S_ISREG(st.st_mode) && st.st_size > 0) {
+            void *mapped = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(mapped != MAP_FAILED) {
+                madvise(mapped, (size_t) st.st_size, MADV_SEQUENTIAL); // Files are scanned from start to end
+                _data = (const char *) mapped;
+                _size = (size_t) st.st_size;
+                _valid = _mapped = true;
+            }
+        }
+        close(fd);
+        if(_mapped)
+            return;
+#endif
+        _valid = _read_file(path, _buffer, max_size, &_too_large); // Empty and non-regular files (eg. pipes) or no mmap support
+        _data = _buffer.data();
+        _size = _buffer.size();
+        if(! _valid && _error.empty())
+            _error = _too_large ? "file too large" : "can't read file";
+    }
+
+    _file_view::~_file_view() {
+#ifdef FIRE_POSIX_
+        if(_mapped)
+            munmap((void *) _data, _size);
+#endif
+    }
+
+    bool _file_view::advise(advice hint) const {
+#ifdef FIRE_POSIX_
+        if(! _mapped)
+            return false;
+        int native[] = {MADV_NORMAL, MADV_SEQUENTIAL, MADV_RANDOM, MADV_WILLNEED, MADV_DONTNEED};
+        return madvise((void *) _data, _size, native[(int) hint]) == 0;
+#else
+        (void) hint;
+        return false;
+#endif
+    }
+
+
     std::string identifier::prepend_hyphens(const std::string &name) {
         if(name.size() == 1)
             return "-" + name;
@@ -311,6 +957,13 @@ namespace fire {
                 _pos_name = name;
                 continue;
             }
+            if(name.size() >= 2 && name.front() == '$' && std::all_of(name.begin() + 1, name.end(),
+                    [](char c) { return isalnum((unsigned char) c) || c == '_'; })) {
+                _instant_assert(! _env.has_value(),
+                        "Can't specify environment variables twice: $" + _env.value_or("") + " and " + name);
+                _env = name.substr(1);
+                continue;
+            }
 
             int hyphens = count_hyphens(name);
             _instant_assert(hyphens <= 2, "Identifier entry " + name + " must prefix either:"
@@ -424,62 +1077,177 @@ namespace fire {
     }
 
 
-    _matcher::_matcher(int argc, const char **argv, int main_argc, bool space_assignment, bool strict) {
+    _matcher::_matcher(int argc, const char **argv, int main_argc, bool space_assignment, bool strict,
+                       bool response_files) {
         _main_argc = main_argc;
         _space_assignment = space_assignment;
         _strict = strict;
+        _response_files = response_files;
+
+        if(argc >= 3 && std::string(argv[1]) == "--fire-complete") { // Hidden mode: --fire-complete INDEX WORDS...
+            std::string index = argv[2];
+            _instant_assert(! index.empty() && index.size() <= 9 && std::all_of(index.begin(), index.end(),
+                            [](char c) { return isdigit(c); }), "invalid word index " + index + " for --fire-complete", false);
+            _completing = true;
+            _complete_index = (size_t) std::stoi(index);
+            _complete_words.assign(argv + 3, argv + argc);
+            argc = 1; // Only declarations are needed for candidates
+        }
 
         parse(argc, argv);
         identifier help({"-h", "--help", "Print the help message"}, optional<int>());
         _help_flag = get_and_mark_as_queried(help).second != arg_type::none_t;
+
+        for(const std::pair<std::string, optional<std::string>> &named: _named)
+            if(named.first.compare(0, 7, "--fire-") == 0) { // Reserved options are looked up only if one is given
+                parse_reserved();
+                break;
+            }
+
         check(false);
     }
 
+    void _matcher::parse_reserved() {
+        identifier config({"--fire-config", "Read arguments from a configuration file"}, optional<int>());
+        auto config_path = get_and_mark_as_queried(config);
+        deferred_assert(config, config_path.second != arg_type::bool_t, "argument --fire-config must have value");
+        if(config_path.second == arg_type::string_t)
+            read_config(config_path.first);
+
+        identifier completion({"--fire-completion", "Print a shell completion script"}, optional<int>());
+        auto completion_shell = get_and_mark_as_queried(completion);
+        deferred_assert(completion, completion_shell.second != arg_type::bool_t, "argument --fire-completion must have value");
+        if(completion_shell.second == arg_type::string_t)
+            _completion_shell = completion_shell.first;
+
+        identifier schema({"--fire-schema", "Print the argument schema as JSON"}, optional<int>());
+        _schema_flag = get_and_mark_as_queried(schema).second != arg_type::none_t;
+
+        identifier shard({"--fire-shard", "Process a slice of vector items"}, optional<int>());
+        auto shard_spec = get_and_mark_as_queried(shard);
+        if(shard_spec.second != arg_type::none_t) { // Takes precedence over $FIRE_SHARD, which isn't read then
+            _queried_names.erase("--fire-shard"); // Until a vector is converted, so it's unused otherwise
+            _shard_given = _shard_resolved = true;
+            _shard_spec = _shard::parse(shard_spec.first);
+            deferred_assert(shard, _shard_spec.has_value(), "invalid shard " + shard_spec.first +
+                                                            " (expected INDEX/COUNT[:contiguous|strided|hash])");
+        }
+    }
+
+    const optional<_shard> & _matcher::shard() {
+        if(_shard_given && _strict)
+            _queried_names.insert("--fire-shard");
+        if(_shard_resolved)
+            return _shard_spec;
+        _shard_resolved = true; // Environment is read only for vector conversions that need it
+
+        const std::string *spec = get_environment("FIRE_SHARD");
+        if(spec) {
+            _shard_spec = _shard::parse(*spec);
+            deferred_assert(identifier({"--fire-shard"}, optional<int>()), _shard_spec.has_value(),
+                            "invalid shard " + *spec + " in FIRE_SHARD (expected INDEX/COUNT[:contiguous|strided|hash])");
+        }
+        return _shard_spec;
+    }
+
     void _matcher::check(bool dec_main_argc) {
         _main_argc -= dec_main_argc;
         if(! _strict || _main_argc > 0) return;
 
         if(_help_flag) {
-            _::help_logger.print_help();
+            _::current_logger().print_help();
+            exit(0);
+        }
+        if(_completion_shell.has_value()) {
+            if(_::declarations_only)
+                throw _declared();
+            std::cout << _::current_logger().completion(_completion_shell.value());
+            exit(0);
+        }
+        if(_schema_flag) {
+            std::cout << _::current_logger().schema(_space_assignment, _response_files);
+            exit(0);
+        }
+        if(_completing) {
+            for(const std::string &candidate: _::current_logger().complete(_complete_index, _complete_words, _space_assignment))
+                std::cout << candidate << "\n";
             exit(0);
         }
 
+        check_structure();
+        exit_on_error();
+        _checked = true;
+    }
+
+    void _matcher::check_structure() {
+        if(_structure_checked)
+            return;
+        if(_rest)
+            collect_rest();
         check_named();
         check_positional();
+        _structure_checked = true;
+    }
+
+    void _matcher::check_before_last() { // Called by expensive conversions, which are skipped for invalid command lines
+        if(_strict && ! _checked && _main_argc == 1)
+            check_structure(); // All other arguments have been queried, so the structure is known
+    }
+
+    void _matcher::fail_fast() { // Reports parsing errors before any argument is converted
+        if(_strict && ! info_requested())
+            exit_on_error();
+    }
 
+    void _matcher::exit_on_error() {
         if(! _deferred_error.empty()) {
             std::cerr << "Error: " << _deferred_error.get() << std::endl;
             exit(_failure_code);
         }
     }
 
+    bool _matcher::info_requested() const {
+        return _help_flag || _completion_shell.has_value() || _schema_flag || _completing;
+    }
+
+    bool _matcher::skip_conversions() const { // Results of conversions won't be used
+        return _completing || (_strict && ! _checked && (info_requested() || ! _deferred_error.empty()));
+    }
+
     void _matcher::check_named() {
+        for(const std::string &name: _repeated_names)
+            deferred_assert(identifier(), _forwarded_named.count(name) > 0, "multiple occurrences of argument " + name);
+
         int invalid_count = 0;
         std::string invalid;
         for(const auto &it: _named) {
-            for(const auto &jt: _queried)
-                if(jt.contains(it.first))
-                    goto VALID;
+            if(_forwarded_named.count(it.first) || _queried_names.count(it.first))
+                continue;
 
             ++invalid_count;
-            invalid += " " + identifier::prepend_hyphens(it.first);
-            VALID:;
+            invalid += " " + it.first; // Names are stored with hyphens
         }
         deferred_assert(identifier(), invalid.empty(),
                         std::string("invalid argument") + (invalid_count > 1 ? "s" : "") + invalid);
     }
 
     void _matcher::check_positional() {
+        if(_space_assignment) { // Positional arguments can only be forwarded
+            deferred_assert(identifier(), _positional.size() == _forwarded_positional.size(),
+                            "positional arguments given, but not accepted");
+            return;
+        }
+        if(_all_positional_queried)
+            return;
+
         int invalid_count = 0;
         std::string invalid;
         for(size_t i = 0; i < _positional.size(); ++i) {
-            for(const auto &it: _queried)
-                if(it.contains((int) i))
-                    goto VALID;
+            if(_forwarded_positional.count(i) || _queried_positions.count((int) i))
+                continue;
 
             ++invalid_count;
             invalid += " " + std::to_string(i);
-            VALID:;
         }
         deferred_assert(identifier(), invalid.empty(),
                         std::string("invalid positional argument") + (invalid_count > 1 ? "s" : "") + invalid);
@@ -489,49 +1257,202 @@ namespace fire {
         if(_space_assignment)
             _instant_assert(! id.get_pos().has_value(), "positional argument used with space assignement enabled: (disable space assignement by calling FIRE_NO_SPACE_ASSIGNMENT(...) instead of FIRE(...))");
 
-        for(const auto& it: _queried)
-            _instant_assert(! it.overlaps(id), "double query for argument " + id.longer());
-
-        if (_strict)
-            _queried.push_back(id);
+        optional<std::string> names[] = {id.get_short_name(), id.get_long_name()};
+        bool overlaps = id.get_pos().has_value() && _queried_positions.count(id.get_pos().value());
+        for(const optional<std::string> &name: names)
+            overlaps |= name.has_value() && _queried_names.count(name.value());
+        _instant_assert(! overlaps, "double query for argument " + id.longer());
+        _instant_assert(! (_all_positional_queried && id.get_pos().has_value()),
+                        "double query for argument " + id.longer());
+
+        if(_strict) {
+            for(const optional<std::string> &name: names)
+                if(name.has_value())
+                    _queried_names.insert(name.value());
+            if(id.get_pos().has_value())
+                _queried_positions.insert(id.get_pos().value());
+        }
 
-        for(auto it = _named.begin(); it != _named.end(); ++it) {
-            if (id.contains(it->first)) {
-                optional<std::string> result = it->second;
-                if (result.has_value())
-                    return {result.value(), arg_type::string_t};
-                return {"", arg_type::bool_t};
-            }
+        size_t first = _named.size(); // If both names are given, the earlier one is used
+        for(const optional<std::string> &name: names) {
+            if(! name.has_value())
+                continue;
+            auto it = _named_index.find(name.value());
+            if(it != _named_index.end())
+                first = std::min(first, it->second);
+        }
+        if(first < _named.size()) {
+            const optional<std::string> &result = _named[first].second;
+            if(result.has_value())
+                return {result.value(), arg_type::string_t};
+            return {"", arg_type::bool_t};
         }
 
         if(id.get_pos().has_value()) {
             size_t pos = id.get_pos().value();
-            if(pos >= _positional.size())
-                return {"", arg_type::none_t};
+            if(pos < _positional.size())
+                return {_positional[pos], arg_type::string_t};
+        }
 
-            return {_positional[pos], arg_type::string_t};
+        if(id.get_env().has_value()) {
+            const std::string *value = get_environment(id.get_env().value());
+            if(value)
+                return {*value, arg_type::string_t};
         }
 
         return {"", arg_type::none_t};
     }
 
+    const std::string * _matcher::get_environment(const std::string &name) {
+        if(! _environment_indexed) { // Single pass over the environment, instead of a getenv() per argument
+#ifdef _WIN32
+            char **environment = _environ;
+#else
+            char **environment = environ;
+#endif
+            for(char **it = environment; it && *it; ++it) {
+                const char *entry = *it, *eq = strchr(entry, '=');
+                if(eq)
+                    _environment.emplace(std::string(entry, eq), std::string(eq + 1));
+            }
+            _environment_indexed = true;
+        }
+
+        auto it = _environment.find(name);
+        return it == _environment.end() ? nullptr : &it->second;
+    }
+
+    void _matcher::set_rest(const identifier &id, std::shared_ptr<std::vector<const char *>> rest,
+                            std::shared_ptr<std::deque<std::string>> copies) {
+        _instant_assert(_strict, "unconsumed arguments require FIRE(...) or FIRE_NO_SPACE_ASSIGNMENT(...)");
+        _instant_assert(! _rest, "double query for argument " + id.longer());
+        _rest = std::move(rest);
+        _rest_copies = std::move(copies);
+    }
+
+    bool _matcher::is_queried(const std::string &name) const {
+        return _queried_names.count(name) > 0;
+    }
+
+    void _matcher::collect_rest() {
+        std::vector<const char *> &rest = *_rest;
+        rest.clear();
+        _rest_copies->clear();
+        bool forward_value = false;
+        for(const _token &token: _tokens) {
+            bool forward = false;
+            if(token.role == _token_role::named) {
+                std::string text = token.text;
+                text = text.substr(0, text.find('='));
+                int hyphens = count_hyphens(text);
+                std::vector<std::string> names(1, text);
+                if(hyphens == 1 && text.size() > 2) { // "-abc" is "-a -b -c"
+                    names.clear();
+                    for(size_t i = 1; i < text.size(); ++i)
+                        names.push_back(std::string("-") + text[i]);
+                }
+                forward = std::none_of(names.begin(), names.end(), [this](const std::string &name) { return is_queried(name); });
+                if(forward)
+                    _forwarded_named.insert(names.begin(), names.end());
+                forward_value = forward;
+            } else if(token.role == _token_role::value)
+                forward = forward_value;
+            else if(token.role == _token_role::separator)
+                forward = ! rest.empty(); // Kept only if it separates forwarded arguments
+            else {
+                forward = ! _all_positional_queried && ! _queried_positions.count((int) token.pos);
+                if(forward)
+                    _forwarded_positional.insert(token.pos);
+            }
+
+            if(! forward)
+                continue;
+            const char *text = token.text ? token.text : _positional[token.pos].c_str();
+            if(_copy_rest) {
+                _rest_copies->emplace_back(text);
+                text = _rest_copies->back().c_str();
+            }
+            rest.push_back(text);
+        }
+        rest.push_back(nullptr);
+    }
+
+    void _matcher::mark_all_positional_as_queried(const identifier &id) {
+        if(_space_assignment && ! _positional.empty())
+            _instant_assert(false, "positional argument used with space assignement enabled: (disable space assignement by calling FIRE_NO_SPACE_ASSIGNMENT(...) instead of FIRE(...))");
+        if(! _strict)
+            return;
+
+        _instant_assert(_queried_positions.empty(), "double query for argument " + id.longer());
+        _instant_assert(! _all_positional_queried, "double query for argument " + id.longer());
+        _all_positional_queried = true;
+    }
+
     void _matcher::parse(int argc, const char **argv) {
         _executable = argv[0];
-        std::vector<std::string> raw = to_vector_string(argc - 1, argv + 1);
+        std::vector<std::string> raw;
+        bool positional_only = false;
+        expand_response_files(to_vector_string(argc - 1, argv + 1), raw, positional_only, 0, argv + 1);
         std::vector<std::string> named;
-        tie(named, _positional) = separate_named_positional(raw);
+        tie(named, _positional) = separate_named_positional(std::move(raw));
         std::vector<std::pair<std::string, bool>> split = split_equations(named);
         _named = assign_named_values(split);
 
         for(size_t i = 0; i < _named.size(); ++i)
-            for(size_t j = 0; j < i; ++j)
-                deferred_assert(identifier(), _named[i].first != _named[j].first,
-                                "multiple occurrences of argument " + identifier::prepend_hyphens(_named[i].first));
+            if(! _named_index.emplace(_named[i].first, i).second)
+                _repeated_names.push_back(_named[i].first);
+        if(! _strict) // Strict programs may forward repeated arguments with fire::rest
+            for(const std::string &name: _repeated_names)
+                deferred_assert(identifier(), false, "multiple occurrences of argument " + name);
 
-        if(_space_assignment)
+        if(_space_assignment && ! _strict) // Strict programs may forward positional arguments with fire::rest
             deferred_assert(identifier(), _positional.empty(), "positional arguments given, but not accepted");
     }
 
+    void _matcher::read_config(const std::string &path) {
+        _file_view file(path);
+        if(! deferred_assert(identifier(), file.valid(), "can't read configuration file " + path)) return;
+
+        std::unordered_set<std::string> configured;
+
+        auto trim = [](const char *begin, const char *end) {
+            while(begin != end && isspace((unsigned char) *begin)) ++begin;
+            while(begin != end && isspace((unsigned char) end[-1])) --end;
+            return std::string(begin, end);
+        };
+
+        const char *it = file.data(), *end = file.data() + file.size();
+        for(int line_number = 1; it != end; ++line_number) { // Lines are "key = value", "flag" or "# comment"
+            const char *eol = std::find(it, end, '\n');
+            std::string line = trim(it, eol);
+            it = eol == end ? end : eol + 1;
+            if(line.empty() || line[0] == '#')
+                continue;
+
+            size_t eq = line.find('=');
+            std::string key = trim(line.data(), line.data() + std::min(eq, line.size()));
+            std::string name = count_hyphens(key) == 0 ? identifier::prepend_hyphens(key) : key;
+            int hyphens = count_hyphens(name);
+            std::string location = " (" + path + ":" + std::to_string(line_number) + ")";
+            if(! deferred_assert(identifier(), (hyphens == 1 && name.size() == 2) || (hyphens == 2 && name.size() >= 4),
+                                 "invalid configuration entry " + line + location)) continue;
+            if(! deferred_assert(identifier(), configured.insert(name).second,
+                                 "multiple occurrences of argument " + name + location)) continue;
+            if(_named_index.count(name)) // Command line takes precedence
+                continue;
+
+            optional<std::string> value;
+            if(eq != std::string::npos) {
+                std::string v = trim(line.data() + eq + 1, line.data() + line.size());
+                if(v.size() >= 2 && (v.front() == '"' || v.front() == '\'') && v.back() == v.front())
+                    v = v.substr(1, v.size() - 2);
+                value = v;
+            }
+            _named_index.emplace(name, _named.size());
+            _named.emplace_back(name, value);
+        }
+    }
+
     std::vector<std::string> _matcher::to_vector_string(int n_strings, const char **strings) {
         std::vector<std::string> raw(n_strings);
         for(int i = 0; i < n_strings; ++i)
@@ -539,37 +1460,120 @@ namespace fire {
         return raw;
     }
 
+    void _matcher::expand_response_files(std::vector<std::string> raw, std::vector<std::string> &expanded,
+                                         bool &positional_only, int depth, const char **origin) {
+        bool value = false; // Value of the previous argument, eg. "--query @q.sql" with space assignment
+        _reserve_more(expanded, raw.size());
+        _reserve_more(_tokens, raw.size());
+        for(size_t i = 0; i < raw.size(); ++i) {
+            std::string &s = raw[i];
+            positional_only |= s == "--"; // Arguments after double dash are never expanded
+            bool literal = positional_only || ! _response_files || value || s.size() < 2 || s[0] != '@';
+            value = _space_assignment && _may_take_value(s);
+            if(! positional_only && s.compare(0, 15, "--fire-argv-fd=") == 0) {
+                read_argv_fd(s.substr(15), expanded);
+                continue;
+            }
+            if(literal) {
+                _tokens.push_back({origin ? origin[i] : nullptr, _token_role::positional, 0});
+                expanded.push_back(std::move(s)); // Response files may hold millions of arguments, so avoid copies
+                continue;
+            }
+
+            std::string path = s.substr(1);
+            if(! deferred_assert(identifier(), depth < _max_response_file_depth,
+                                 "response files nested too deeply (" + path + ")")) continue;
+
+            std::vector<std::string> args;
+            if(! deferred_assert(identifier(), _read_response_file(path, args, _response_file_cache),
+                                 "can't read response file " + path)) continue;
+            expand_response_files(std::move(args), expanded, positional_only, depth + 1);
+        }
+    }
+
+    void _matcher::read_argv_fd(const std::string &fd_string, std::vector<std::string> &expanded) {
+        // Arguments are given as a 4-byte little-endian length followed by the bytes, until end of file
+        bool valid_fd = ! fd_string.empty() && fd_string.size() <= 9 &&
+                        std::all_of(fd_string.begin(), fd_string.end(), [](char c) { return isdigit(c); });
+        if(! deferred_assert(identifier(), valid_fd, "invalid file descriptor " + fd_string + " for --fire-argv-fd")) return;
+
+#ifdef FIRE_POSIX_
+        int fd = std::stoi(fd_string);
+        std::string data;
+        std::vector<char> chunk(_stdin_chunk_size);
+        ssize_t count;
+        while((count = read(fd, chunk.data(), chunk.size())) > 0)
+            data.append(chunk.data(), (size_t) count);
+        close(fd);
+        if(! deferred_assert(identifier(), count == 0, "can't read arguments from file descriptor " + fd_string)) return;
+
+        for(size_t pos = 0; pos < data.size(); ) {
+            bool complete = data.size() - pos >= 4;
+            size_t length = 0;
+            for(size_t i = 0; complete && i < 4; ++i)
+                length |= (size_t) (unsigned char) data[pos + i] << (8 * i);
+            complete = complete && data.size() - pos - 4 >= length;
+            if(! deferred_assert(identifier(), complete, "truncated arguments in file descriptor " + fd_string)) return;
+
+            _tokens.push_back({nullptr, _token_role::positional, 0});
+            expanded.emplace_back(data, pos + 4, length);
+            pos += 4 + length;
+        }
+#else
+        deferred_assert(identifier(), false, "--fire-argv-fd is not supported on this platform");
+#endif
+    }
+
     std::tuple<std::vector<std::string>, std::vector<std::string>>
-            _matcher::separate_named_positional(const std::vector<std::string> &raw) {
+            _matcher::separate_named_positional(std::vector<std::string> raw) {
         std::vector<std::string> named, positional;
 
+        auto set_role = [this, &positional](size_t i, _token_role role, const std::string &s) {
+            if(i >= _tokens.size()) // Tokens are recorded only by parse()
+                return;
+            _tokens[i].role = role;
+            _tokens[i].pos = positional.size();
+            if(! _tokens[i].text && role != _token_role::positional) {
+                _expanded_named.push_back(s);
+                _tokens[i].text = _expanded_named.back().c_str();
+            }
+        };
+
         bool to_named = false;
         for(size_t i = 0; i < raw.size(); ++i) {
-            const std::string &s = raw[i];
+            std::string &s = raw[i];
             int hyphens = count_hyphens(s);
             int name_size = (int) s.size() - hyphens;
 
             if(s == "--") { // Double dash indicates that upcoming arguments are positional only
-                positional.insert(positional.end(), raw.begin() + i + 1, raw.end());
+                set_role(i, _token_role::separator, s);
+                for(size_t j = i + 1; j < raw.size(); ++j) {
+                    set_role(j, _token_role::positional, raw[j]);
+                    positional.push_back(std::move(raw[j]));
+                }
                 break;
             }
 
-            deferred_assert(identifier(), hyphens <= 2, "too many hyphens: " + s);
+            if(hyphens > 2) // Message is built only on failure, response files may hold millions of arguments
+                deferred_assert(identifier(), false, "too many hyphens: " + s);
             if(hyphens == 2 || (hyphens == 1 && name_size >= 1 && !isdigit(s[1]))) {
-                named.push_back(s);
                 to_named = hyphens >= 2 || name_size == 1; // Not "-abc" == "-a -b -c"
                 to_named &= (s.find('=') == std::string::npos); // No equation signs
+                set_role(i, _token_role::named, s);
+                named.push_back(std::move(s));
                 continue;
             }
             if(_space_assignment && to_named) {
-                named.push_back(s);
+                set_role(i, _token_role::value, s);
+                named.push_back(std::move(s));
                 to_named = false;
                 continue;
             }
-            positional.push_back(s);
+            set_role(i, _token_role::positional, s);
+            positional.push_back(std::move(s));
         }
 
-        return std::tuple<std::vector<std::string>, std::vector<std::string>>(named, positional);
+        return std::make_tuple(std::move(named), std::move(positional));
     }
 
     std::vector<std::pair<std::string, bool>> _matcher::split_equations(const std::vector<std::string> &named) {
@@ -620,7 +1624,7 @@ namespace fire {
     }
 
     bool _matcher::deferred_assert(const identifier &id, bool pass, const std::string &msg) {
-        if(! _strict) {
+        if(! _strict || _checked) {
             _instant_assert(pass, msg, false);
             return pass;
         }
@@ -629,7 +1633,15 @@ namespace fire {
         return pass;
     }
 
+    optional<std::string> _matcher::deferred_error() const {
+        if(_deferred_error.empty())
+            return {};
+        return _deferred_error.get();
+    }
+
     std::string _help_logger::_make_printable(const identifier &id, const log_elem &elem, bool verbose) {
+        if(elem.rest)
+            return "[ARGS...]";
         std::string printable;
         if(elem.optional || elem.type == "") printable += "[";
         printable += verbose ? id.help() : id.longer();
@@ -650,13 +1662,15 @@ namespace fire {
         options += "      " + printable + std::string(2 + margin - printable.size(), ' ') + elem.descr;
         if(! elem.def.empty())
             options += " [default: " + elem.def + "]";
+        if(id.get_env().has_value())
+            options += " [env: " + id.get_env().value() + "]";
         options += "\n";
     }
 
     void _help_logger::print_help() {
         using id2elem = std::pair<identifier, log_elem>;
 
-        std::string usage = "    Usage:\n      " + _::matcher.get_executable();
+        std::string usage = "    Usage:\n      " + _::current_matcher().get_executable();
         std::string options = "    Options:\n";
 
         std::vector<id2elem> printed(_params);
@@ -677,16 +1691,319 @@ namespace fire {
         std::cerr << std::endl << usage << std::endl << std::endl << std::endl << options << std::endl;
     }
 
-    void _help_logger::log(const identifier &name, const log_elem &_elem) {
+    void _help_logger::check_shell(const std::string &shell) {
+        _instant_assert(shell == "bash" || shell == "zsh" || shell == "fish",
+                        "unknown shell " + shell + " for --fire-completion (expected bash, zsh or fish)", false);
+    }
+
+    std::string _help_logger::completion(const std::string &shell) {
+        check_shell(shell);
+        std::string command = _program_name(_::current_matcher().get_executable());
+        std::string function = _function_name(command);
+        std::vector<std::pair<identifier, log_elem>> params = _params_with_help();
+        bool files = _completes_files(params);
+
+        if(shell == "bash")
+            return _bash_function(function, params, files) + "complete -o filenames -F " + function + " " + command + "\n";
+        if(shell == "zsh")
+            return "#compdef " + command + "\n" + _zsh_function(function, params) + "compdef " + function + " " + command + "\n";
+        return _fish_completion(command, "", params, files);
+    }
+
+    std::string _help_logger::completion(const std::string &shell, const std::string &executable,
+                                         std::vector<std::pair<std::string, _help_logger>> &commands) {
+        check_shell(shell); // Script dispatches on the first word, which is completed as a command name
+        std::string command = _program_name(executable);
+        std::string function = _function_name(command);
+        std::string names, functions, cases;
+        for(auto &it: commands) {
+            std::string command_function = function + "_" + it.first;
+            std::vector<std::pair<identifier, log_elem>> params = it.second._params_with_help();
+            bool files = _completes_files(params);
+            names += (names.empty() ? "" : " ") + it.first;
+            if(shell == "bash")
+                functions += _bash_function(command_function, params, files);
+            else if(shell == "zsh")
+                functions += _zsh_function(command_function, params);
+            else
+                functions += _fish_completion(command, "__fish_seen_subcommand_from " + it.first, params, files);
+            cases += "        " + it.first + ") " + command_function + ";;\n";
+        }
+
+        if(shell == "bash")
+            return functions + function + "() {\n"
+                "    if [[ $COMP_CWORD -le 1 ]]; then\n"
+                "        COMPREPLY=($(compgen -W \"" + names + "\" -- \"${COMP_WORDS[COMP_CWORD]}\"))\n"
+                "        return\n"
+                "    fi\n"
+                "    case \"${COMP_WORDS[1]}\" in\n" + cases +
+                "    esac\n"
+                "}\n"
+                "complete -o filenames -F " + function + " " + command + "\n";
+        if(shell == "zsh")
+            return "#compdef " + command + "\n" + functions + function + "() {\n"
+                "    if (( CURRENT == 2 )); then\n"
+                "        compadd " + names + "\n"
+                "        return\n"
+                "    fi\n"
+                "    shift words\n"
+                "    (( CURRENT-- ))\n"
+                "    case \"$words[1]\" in\n" + cases +
+                "    esac\n"
+                "}\n"
+                "compdef " + function + " " + command + "\n";
+        return "complete -c " + command + " -n __fish_use_subcommand -f -a '" + names + "'\n" + functions;
+    }
+
+    std::vector<std::string> _help_logger::complete(size_t index, const std::vector<std::string> &words,
+                                                    bool space_assignment) {
+        std::vector<std::pair<identifier, log_elem>> params = _params_with_help();
+
+        std::unordered_set<std::string> used; // Options already given aren't suggested again
+        for(size_t i = 1; i < words.size(); ++i)
+            if(i != index)
+                used.insert(words[i].substr(0, words[i].find('=')));
+
+        if(space_assignment && index >= 2 && index - 1 < words.size()) // Values are completed by the shell
+            for(const auto &it: params)
+                for(const std::string &name: _names(it.first))
+                    if(name == words[index - 1] && it.second.type != "")
+                        return {};
+
+        std::string current = index < words.size() ? words[index] : "";
+        if(current.empty() || current[0] != '-' || current.find('=') != std::string::npos)
+            return {};
+
+        std::vector<std::string> candidates;
+        for(const auto &it: params) {
+            std::vector<std::string> names = _names(it.first);
+            if(std::any_of(names.begin(), names.end(), [&used](const std::string &name) { return used.count(name); }))
+                continue;
+            for(const std::string &name: names)
+                if(name.compare(0, current.size(), current) == 0)
+                    candidates.push_back(name);
+        }
+        std::sort(candidates.begin(), candidates.end());
+        return candidates;
+    }
+
+    std::string _help_logger::_program_name(const std::string &executable) {
+        std::string program = executable.substr(0, executable.find(' ')); // Subcommands are shown as "program command"
+        size_t separator = program.find_last_of("/\\");
+        if(separator != std::string::npos)
+            program = program.substr(separator + 1);
+        return program;
+    }
+
+    std::vector<std::pair<identifier, _help_logger::log_elem>> _help_logger::_params_with_help() {
+        std::vector<std::pair<identifier, log_elem>> params(_params);
+        params.emplace_back(identifier({"-h", "--help", "Print the help message"}, optional<int>()),
+                            log_elem{"Print the help message", "", "", true, "", false, "", "", ""});
+        return params;
+    }
+
+    std::string _help_logger::schema(bool space_assignment, bool response_files) {
+        auto quote = [](const std::string &text) {
+            std::string quoted = "\"";
+            for(char c: text) {
+                if(c == '"' || c == '\\')
+                    quoted += std::string("\\") + c;
+                else if((unsigned char) c < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned) c);
+                    quoted += escaped;
+                } else
+                    quoted += c;
+            }
+            return quoted + "\"";
+        };
+        auto optional_quote = [&quote](const optional<std::string> &text) {
+            return text.has_value() ? quote(text.value()) : "null";
+        };
+
+        std::string arguments, vector = "null", rest = "null";
+        for(const auto &it: _params) {
+            const identifier &id = it.first;
+            const log_elem &elem = it.second;
+            if(elem.rest) {
+                rest = "{\"description\": " + quote(elem.descr) + "}";
+                continue;
+            }
+            if(id.vector()) {
+                vector = "{\"description\": " + quote(elem.descr) + ", \"type\": " + quote(elem.element_type) +
+                         ", \"source\": " + quote(elem.source) + "}";
+                continue;
+            }
+
+            if(! arguments.empty())
+                arguments += ",";
+            arguments += "\n    {\"short\": " + optional_quote(id.get_short_name()) +
+                         ", \"long\": " + optional_quote(id.get_long_name()) +
+                         ", \"position\": " + (id.get_pos().has_value() ? std::to_string(id.get_pos().value()) : "null") +
+                         ", \"positional_name\": " + optional_quote(id.get_pos_name()) +
+                         ", \"description\": " + quote(elem.descr) +
+                         ", \"type\": " + quote(elem.type.empty() ? "FLAG" : elem.type) +
+                         ", \"min\": " + (elem.min.empty() ? "null" : elem.min) +
+                         ", \"max\": " + (elem.max.empty() ? "null" : elem.max) +
+                         ", \"default\": " + (elem.def.empty() ? "null" : quote(elem.def)) +
+                         ", \"optional\": " + (elem.optional ? "true" : "false") +
+                         ", \"env\": " + optional_quote(id.get_env()) + "}";
+        }
+
+        return "{\n  \"program\": " + quote(_program_name(_::current_matcher().get_executable())) +
+               ",\n  \"space_assignment\": " + (space_assignment ? "true" : "false") +
+               ",\n  \"response_files\": " + (response_files ? "true" : "false") +
+               ",\n  \"arguments\": [" + arguments + (arguments.empty() ? "]" : "\n  ]") +
+               ",\n  \"vector\": " + vector +
+               ",\n  \"rest\": " + rest + "\n}\n";
+    }
+
+    std::vector<std::string> _help_logger::_names(const identifier &id) {
+        std::vector<std::string> names;
+        if(id.get_short_name().has_value())
+            names.push_back(id.get_short_name().value());
+        if(id.get_long_name().has_value())
+            names.push_back(id.get_long_name().value());
+        return names;
+    }
+
+    std::string _help_logger::_function_name(const std::string &command) {
+        std::string function = "_fire_";
+        for(char c: command)
+            function += isalnum((unsigned char) c) ? c : '_';
+        return function;
+    }
+
+    bool _help_logger::_completes_files(const std::vector<std::pair<identifier, log_elem>> &params) {
+        bool files = false; // Positional arguments are completed as file names
+        for(const auto &it: params)
+            files |= it.first.get_pos().has_value() || it.first.vector();
+        return files;
+    }
+
+    std::string _help_logger::_bash_function(const std::string &function,
+                                             const std::vector<std::pair<identifier, log_elem>> &params, bool files) {
+        std::string words, path_options, value_options;
+        for(const auto &it: params)
+            for(const std::string &name: _names(it.first)) {
+                words += (words.empty() ? "" : " ") + name;
+                if(it.second.type == "PATH")
+                    path_options += (path_options.empty() ? "" : "|") + name;
+                else if(it.second.type != "")
+                    value_options += (value_options.empty() ? "" : "|") + name;
+            }
+
+        std::string script = function + "() {\n"
+            "    local cur=\"${COMP_WORDS[COMP_CWORD]}\" prev=\"${COMP_WORDS[COMP_CWORD-1]}\"\n"
+            "    if [[ \"$cur\" == \"=\" ]]; then\n"
+            "        cur=\"\"\n"
+            "    elif [[ \"$prev\" == \"=\" ]]; then\n"
+            "        prev=\"${COMP_WORDS[COMP_CWORD-2]}\"\n"
+            "    fi\n"
+            "    case \"$prev\" in\n";
+        if(! path_options.empty())
+            script += "        " + path_options + ") COMPREPLY=($(compgen -f -- \"$cur\")); return;;\n";
+        if(! value_options.empty())
+            script += "        " + value_options + ") COMPREPLY=(); return;;\n";
+        script += "    esac\n"
+            "    if [[ \"$cur\" == -* ]]; then\n"
+            "        COMPREPLY=($(compgen -W \"" + words + "\" -- \"$cur\"))\n";
+        if(files)
+            script += "    else\n"
+                "        COMPREPLY=($(compgen -f -- \"$cur\"))\n";
+        script += "    fi\n"
+            "}\n";
+        return script;
+    }
+
+    std::string _help_logger::_zsh_function(const std::string &function,
+                                            const std::vector<std::pair<identifier, log_elem>> &params) {
+        auto escape = [](const std::string &text) {
+            std::string escaped;
+            for(char c: text) {
+                if(c == '\'')
+                    escaped += "'\\''";
+                else {
+                    if(c == '[' || c == ']' || c == ':' || c == '\\')
+                        escaped += '\\';
+                    escaped += c;
+                }
+            }
+            return escaped;
+        };
+
+        std::string script = function + "() {\n    _arguments -s";
+        for(const auto &it: params) {
+            const identifier &id = it.first;
+            const log_elem &elem = it.second;
+            std::string action = elem.type == "PATH" ? "_files" : " ";
+            std::vector<std::string> names = _names(id);
+            if(! names.empty()) {
+                std::string value = elem.type == "" ? "" : "=";
+                std::string spec = "[" + escape(elem.descr) + "]";
+                if(elem.type != "")
+                    spec += ":" + elem.type + ":" + action;
+                if(names.size() == 1)
+                    script += " \\\n        '" + names[0] + value + spec + "'";
+                else
+                    script += " \\\n        '(" + names[0] + " " + names[1] + ")'{" +
+                              names[0] + value + "," + names[1] + value + "}'" + spec + "'";
+            } else if(id.get_pos().has_value())
+                script += " \\\n        '" + std::to_string(id.get_pos().value() + 1) + ":" + escape(id.help()) + ":_files'";
+            else
+                script += " \\\n        '*:" + escape(id.get_descr().empty() ? "files" : id.get_descr()) + ":_files'";
+        }
+        script += "\n}\n";
+        return script;
+    }
+
+    std::string _help_logger::_fish_completion(const std::string &command, const std::string &condition,
+                                               const std::vector<std::pair<identifier, log_elem>> &params, bool files) {
+        auto escape = [](const std::string &text) {
+            std::string escaped;
+            for(char c: text) {
+                if(c == '\'' || c == '\\')
+                    escaped += '\\';
+                escaped += c;
+            }
+            return escaped;
+        };
+
+        std::string prefix = "complete -c " + command; // Condition selects a subcommand
+        if(! condition.empty())
+            prefix += " -n '" + condition + "'";
+
+        std::string script;
+        if(! files)
+            script += prefix + " -f\n";
+        for(const auto &it: params) {
+            const identifier &id = it.first;
+            if(_names(id).empty())
+                continue;
+
+            script += prefix;
+            if(id.get_short_name().has_value())
+                script += " -s " + id.get_short_name().value().substr(1);
+            if(id.get_long_name().has_value())
+                script += " -l " + id.get_long_name().value().substr(2);
+            if(it.second.type == "PATH")
+                script += " -r -F";
+            else if(it.second.type != "")
+                script += " -x";
+            script += " -d '" + escape(it.second.descr) + "'\n";
+        }
+        return script;
+    }
+
+    void _help_logger::log(const identifier &name, const log_elem &_elem) {
         log_elem elem = _elem;
         elem.optional |= ! elem.def.empty();
         _params.emplace_back(name, elem);
     }
 
     template <>
-    inline optional<long long> arg::_get<long long>() {
-        auto elem = _::matcher.get_and_mark_as_queried(_id);
-        _::matcher.deferred_assert(_id, elem.second != _matcher::arg_type::bool_t,
+    inline optional<long long> arg::_get<long long>(const _elem &elem) {
+        _::current_matcher().deferred_assert(_id, elem.second != _matcher::arg_type::bool_t,
                                    "argument " + _id.help() + " must have value");
         if(elem.second == _matcher::arg_type::string_t) {
             size_t last = 0;
@@ -695,12 +2012,12 @@ namespace fire {
             try {
                 converted = std::stoll(elem.first, &last);
             } catch(std::out_of_range &) {
-                _::matcher.deferred_assert(_id, false, "value " + elem.first + " out of range");
+                _::current_matcher().deferred_assert(_id, false, "value " + elem.first + " out of range");
             } catch(std::invalid_argument &) {
                 is_int = false;
             }
 
-            _::matcher.deferred_assert(_id, is_int && last == elem.first.size(), // last != elem.first.size() indicates floating point
+            _::current_matcher().deferred_assert(_id, is_int && last == elem.first.size(), // last != elem.first.size() indicates floating point
                                        "value " + elem.first + " is not an integer");
 
             return converted;
@@ -710,17 +2027,16 @@ namespace fire {
     }
 
     template <>
-    inline optional<long double> arg::_get<long double>() {
-        auto elem = _::matcher.get_and_mark_as_queried(_id);
-        _::matcher.deferred_assert(_id, elem.second != _matcher::arg_type::bool_t,
+    inline optional<long double> arg::_get<long double>(const _elem &elem) {
+        _::current_matcher().deferred_assert(_id, elem.second != _matcher::arg_type::bool_t,
                                    "argument " + _id.help() + " must have value");
         if(elem.second == _matcher::arg_type::string_t) {
             try {
                 return std::stold(elem.first);
             } catch(std::out_of_range &) {
-                _::matcher.deferred_assert(_id, false, "value " + elem.first + " out of range");
+                _::current_matcher().deferred_assert(_id, false, "value " + elem.first + " out of range");
             } catch(std::invalid_argument &) {
-                _::matcher.deferred_assert(_id, false, "value " + elem.first + " is not a real number");
+                _::current_matcher().deferred_assert(_id, false, "value " + elem.first + " is not a real number");
             }
         }
 
@@ -730,9 +2046,8 @@ namespace fire {
     }
 
     template <>
-    inline optional<std::string> arg::_get<std::string>() {
-        auto elem = _::matcher.get_and_mark_as_queried(_id);
-        _::matcher.deferred_assert(_id, elem.second != _matcher::arg_type::bool_t,
+    inline optional<std::string> arg::_get<std::string>(const _elem &elem) {
+        _::current_matcher().deferred_assert(_id, elem.second != _matcher::arg_type::bool_t,
                                    "argument " + _id.help() + " must have value");
 
         if(elem.second == _matcher::arg_type::string_t)
@@ -741,8 +2056,8 @@ namespace fire {
     }
 
     template <typename T, typename std::enable_if<std::is_integral<T>::value && ! std::is_same<T, bool>::value>::type*>
-    optional<T> arg::_get_with_precision() {
-        optional<long long> opt_value = _get<long long>();
+    optional<T> arg::_get_with_precision(const _elem &elem) {
+        optional<long long> opt_value = _get<long long>(elem);
         if(! opt_value.has_value())
             return optional<T>();
         long long value = opt_value.value();
@@ -751,17 +2066,17 @@ namespace fire {
         T min = std::numeric_limits<T>::lowest();
         T max = std::numeric_limits<T>::max();
 
-        _::matcher.deferred_assert(_id, is_signed || value >= 0,
+        _::current_matcher().deferred_assert(_id, is_signed || value >= 0,
                                    "argument " + _id.help() + " must be positive");
-        _::matcher.deferred_assert(_id, min <= value && value <= max,
+        _::current_matcher().deferred_assert(_id, min <= value && value <= max,
                                    "value " + std::to_string(value) + " out of range");
 
         return (T) value;
     }
 
     template <typename T, typename std::enable_if<std::is_floating_point<T>::value>::type*>
-    optional<T> arg::_get_with_precision() {
-        optional<long double> opt_value = _get<long double>();
+    optional<T> arg::_get_with_precision(const _elem &elem) {
+        optional<long double> opt_value = _get<long double>(elem);
         if(! opt_value.has_value())
             return optional<T>();
         long double value = opt_value.value();
@@ -769,7 +2084,7 @@ namespace fire {
         T min = std::numeric_limits<T>::lowest();
         T max = std::numeric_limits<T>::max();
 
-        _::matcher.deferred_assert(_id, min <= value && value <= max,
+        _::current_matcher().deferred_assert(_id, min <= value && value <= max,
                                    "value " + std::to_string(value) + " out of range");
 
         return (T) value;
@@ -779,27 +2094,35 @@ namespace fire {
     optional<T> arg::_convert_optional(bool dec_main_argc) {
         _instant_assert(! (_int_value.has_value() || _float_value.has_value() || _string_value.has_value()),
                         "optional argument has default value");
-        optional<T> val = _get_with_precision<T>();
-        _::matcher.check(dec_main_argc);
+        optional<T> val = _get_with_precision<T>(_::current_matcher().get_and_mark_as_queried(_id));
+        _::current_matcher().check(dec_main_argc);
         return val;
     }
 
+    template <typename T>
+    T arg::_convert_value(const std::string &value) {
+        return _get_with_precision<T>({value, _matcher::arg_type::string_t}).value_or(T());
+    }
+
     template <typename T>
     T arg::_convert(bool dec_main_argc) {
-        optional<T> val = _get_with_precision<T>();
-        _::matcher.deferred_assert(_id, val.has_value(),
+        optional<T> val = _get_with_precision<T>(_::current_matcher().get_and_mark_as_queried(_id));
+        _::current_matcher().deferred_assert(_id, val.has_value(),
                                    "required argument " + _id.longer() + " not provided");
-        _::matcher.check(dec_main_argc);
+        _::current_matcher().check(dec_main_argc);
         return val.value_or(T());
     }
 
-    void arg::_log(const std::string &type, bool optional) {
+    void arg::_log(const std::string &type, bool optional, const std::string &element_type, bool rest,
+                   const std::pair<std::string, std::string> &limits) {
         std::string def;
         if(_int_value.has_value()) def = std::to_string(_int_value.value());
         if(_float_value.has_value()) def = std::to_string(_float_value.value());
         if(_string_value.has_value()) def = _string_value.value();
 
-        _::help_logger.log(_id, {_id.get_descr(), type, def, optional});
+        std::string source = _stdin_delimiter.has_value() ? "stdin" : _expand_paths ? "paths" : "positional";
+        _::current_logger().log(_id, {_id.get_descr(), type, def, optional, element_type, rest, source,
+                                      limits.first, limits.second});
     }
 
     arg arg::vector(std::string descr) {
@@ -808,27 +2131,1025 @@ namespace fire {
         return a;
     }
 
+    arg arg::stdin_vector(std::string descr, char delimiter) {
+        arg a = vector(descr);
+        a._stdin_delimiter = delimiter;
+        return a;
+    }
+
+    arg arg::path_vector(std::string descr) {
+        arg a = vector(descr);
+        a._expand_paths = true;
+        return a;
+    }
+
+    arg arg::unconsumed(std::string descr) {
+        return vector(descr);
+    }
+
+    arg::operator rest() {
+        rest forwarded;
+        _::current_matcher().set_rest(_id, forwarded._args, forwarded._copies);
+        _log("", true, "STRING", true);
+        _::current_matcher().check(true);
+        return forwarded;
+    }
+
+    std::shared_ptr<_item_source> arg::_item_source_for_vector() {
+        std::shared_ptr<_item_source> source;
+        bool known_size = false;
+        if(_stdin_delimiter.has_value()) {
+            if(_::current_matcher().skip_conversions()) { // Nothing is read, and positional arguments aren't the vector's
+                _::current_matcher().check_before_last();
+                return std::make_shared<_empty_source>();
+            }
+            source = std::make_shared<_stdin_source>(_stdin_delimiter.value());
+        } else {
+            _::current_matcher().mark_all_positional_as_queried(_id);
+            source = std::make_shared<_positional_source>();
+            known_size = ! _expand_paths;
+            if(_expand_paths)
+                source = std::make_shared<_path_source>(source);
+        }
+
+        const optional<_shard> &shard = _::current_matcher().shard();
+        if(shard.has_value()) {
+            _::current_matcher().deferred_assert(_id, known_size || shard.value().selection != _shard::mode::contiguous,
+                                       "contiguous shards require a known number of items (use strided or hash)");
+            source = std::make_shared<_shard_source>(source, shard.value(), known_size ? _::current_matcher().pos_args() : 0);
+        }
+        _::current_matcher().check_before_last();
+        return source;
+    }
+
+    arg::operator string_ref() {
+        _log("STRING", false);
+        auto elem = _::current_matcher().get_and_mark_as_queried(_id);
+        optional<std::string> value = _get<std::string>(elem);
+        _::current_matcher().deferred_assert(_id, value.has_value(),
+                                   "required argument " + _id.longer() + " not provided");
+
+        _::current_matcher().check_before_last();
+        string_ref ref = string_ref::_owning(value.value_or(""));
+        const std::string &v = elem.first;
+        if(elem.second == _matcher::arg_type::string_t && v.size() >= 2 && v[0] == '@' && ! _::current_matcher().skip_conversions()) {
+            if(v[1] == '@') // Escaped "@@..." is a literal value
+                ref = string_ref::_owning(v.substr(1));
+            else {
+                std::string path = v.substr(1);
+                auto file = std::make_shared<const _file_view>(path, _max_value_file_size);
+                if(_::current_matcher().deferred_assert(_id, ! file->too_large(),
+                                              "file " + path + " for argument " + _id.help() + " is too large") &&
+                   _::current_matcher().deferred_assert(_id, file->valid(), "can't read file " + path + " for argument " + _id.help()))
+                    ref = string_ref::_mapped(file);
+            }
+        }
+
+        _::current_matcher().check(true);
+        return ref;
+    }
+
+    arg::operator mapped_file() {
+        _log("PATH", false);
+        optional<std::string> path = _get<std::string>(_::current_matcher().get_and_mark_as_queried(_id));
+        _::current_matcher().deferred_assert(_id, path.has_value(),
+                                   "required argument " + _id.longer() + " not provided");
+
+        _::current_matcher().check_before_last();
+        mapped_file file;
+        if(path.has_value() && ! _::current_matcher().skip_conversions()) {
+            auto view = std::make_shared<const _file_view>(path.value());
+            if(_::current_matcher().deferred_assert(_id, view->valid(), "can't open file " + path.value() + " for argument " +
+                                                              _id.help() + ": " + view->error())) {
+                file._file = view;
+                file._path = path.value();
+            }
+        }
+
+        _::current_matcher().check(true);
+        return file;
+    }
+
     arg::operator bool() {
         _instant_assert(!_int_value.has_value() && !_float_value.has_value() && !_string_value.has_value(),
                 _id.longer() + " flag parameter must not have default value");
+        _instant_assert(! _id.get_env().has_value(),
+                _id.longer() + " flag parameter must not have environment variable");
 
         _log("", true); // User sees this as flag, not boolean option
-        auto elem = _::matcher.get_and_mark_as_queried(_id);
-        _::matcher.deferred_assert(_id, elem.second != _matcher::arg_type::string_t,
+        auto elem = _::current_matcher().get_and_mark_as_queried(_id);
+        _::current_matcher().deferred_assert(_id, elem.second != _matcher::arg_type::string_t,
                                    "flag " + _id.help() + " must not have value");
-        _::matcher.check(true);
+        _::current_matcher().check(true);
         return elem.second == _matcher::arg_type::bool_t;
     }
 
     template <typename T>
     arg::operator std::vector<T>() {
         std::vector<T> ret;
-        for(size_t i = 0; i < _::matcher.pos_args(); ++i)
-            ret.push_back(arg((int) i)._convert<T>(false));
-        _log("", true);
-        _::matcher.check(true);
+        if(_stdin_delimiter.has_value() || _expand_paths || _::current_matcher().shard().has_value()) {
+            std::shared_ptr<_item_source> source = _item_source_for_vector();
+            std::string item;
+            while(! _::current_matcher().skip_conversions() && source->next(item))
+                ret.push_back(_convert_value<T>(item));
+        } else {
+            _::current_matcher().mark_all_positional_as_queried(_id);
+            _::current_matcher().check_before_last();
+            ret.reserve(_::current_matcher().pos_args());
+            for(size_t i = 0; i < _::current_matcher().pos_args() && ! _::current_matcher().skip_conversions(); ++i)
+                ret.push_back(_convert_value<T>(_::current_matcher().get_positional(i)));
+        }
+        _log("", true, _type_name<T>());
+        _::current_matcher().check(true);
         return ret;
     }
+
+    template <typename T>
+    arg::operator stream<T>() {
+        std::shared_ptr<_item_source> source = _item_source_for_vector();
+        _log("", true, _type_name<T>());
+        _::current_matcher().check(true);
+        return stream<T>(*this, source);
+    }
+
+    template <typename T>
+    typename stream<T>::iterator & stream<T>::iterator::operator++() {
+        std::string item;
+        if(_stream->_source->next(item))
+            _value = _stream->_arg.template _convert_value<T>(item);
+        else
+            _stream = nullptr;
+        return *this;
+    }
+
+    bool _positional_source::next(std::string &item) {
+        if(_next >= _::current_matcher().pos_args())
+            return false;
+        item = _::current_matcher().get_positional(_next++);
+        return true;
+    }
+
+    bool _stdin_source::next(std::string &item) {
+        item.clear();
+        while(true) {
+            const char *begin = _chunk.data() + _begin, *end = _chunk.data() + _end;
+            const char *delimiter = std::find(begin, end, _delimiter);
+            item.append(begin, delimiter);
+            if(delimiter != end) {
+                _begin = (size_t) (delimiter - _chunk.data()) + 1;
+                return true;
+            }
+
+            _begin = 0;
+            _end = std::fread(_chunk.data(), 1, _chunk.size(), stdin);
+            if(_end == 0) // Last item may lack a delimiter
+                return ! item.empty();
+        }
+    }
+
+    optional<_shard> _shard::parse(const std::string &spec) {
+        size_t slash = spec.find('/'), colon = spec.find(':');
+        if(slash == std::string::npos || (colon != std::string::npos && colon < slash))
+            return optional<_shard>();
+        std::string index = spec.substr(0, slash);
+        std::string count = spec.substr(slash + 1, colon == std::string::npos ? std::string::npos : colon - slash - 1);
+        std::string selection = colon == std::string::npos ? "contiguous" : spec.substr(colon + 1);
+
+        auto is_number = [](const std::string &s) {
+            return ! s.empty() && s.size() <= 18 && std::all_of(s.begin(), s.end(), [](char c) { return isdigit(c); });
+        };
+        if(! is_number(index) || ! is_number(count))
+            return optional<_shard>();
+
+        _shard shard;
+        shard.index = (size_t) std::stoull(index);
+        shard.count = (size_t) std::stoull(count);
+        if(shard.count == 0 || shard.index >= shard.count)
+            return optional<_shard>();
+        if(selection == "strided")
+            shard.selection = mode::strided;
+        else if(selection == "hash")
+            shard.selection = mode::hash;
+        else if(selection != "contiguous")
+            return optional<_shard>();
+        return shard;
+    }
+
+    _shard_source::_shard_source(std::shared_ptr<_item_source> base, const _shard &spec, size_t total):
+            _base(std::move(base)), _spec(spec) {
+        _begin = (size_t) ((unsigned long long) total * spec.index / spec.count);
+        _end = (size_t) ((unsigned long long) total * (spec.index + 1) / spec.count);
+    }
+
+    bool _shard_source::next(std::string &item) {
+        while(_base->next(item)) {
+            size_t i = _next++;
+            if(_spec.selection == _shard::mode::contiguous) {
+                if(i >= _end)
+                    return false;
+                if(i >= _begin)
+                    return true;
+            } else if(_spec.selection == _shard::mode::strided) {
+                if(i % _spec.count == _spec.index)
+                    return true;
+            } else {
+                uint64_t hash = 14695981039346656037ull; // FNV-1a, so shards don't depend on item order or platform
+                for(char c: item)
+                    hash = (hash ^ (unsigned char) c) * 1099511628211ull;
+                if(hash % _spec.count == _spec.index)
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    bool _path_source::next(std::string &item) {
+#ifdef FIRE_POSIX_
+        while(true) {
+            if(_pending.empty()) {
+                if(! _base->next(item))
+                    return false;
+                if(item.find_first_of("*?[") != std::string::npos)
+                    _push_pattern(item);
+                else
+                    _pending.emplace_back(std::move(item), kind::unknown);
+                continue;
+            }
+
+            std::pair<std::string, kind> path = std::move(_pending.back());
+            _pending.pop_back();
+            struct stat st;
+            if(path.second == kind::unknown) // Nonexistent paths are passed on unchanged
+                path.second = stat(path.first.c_str(), &st) == 0 && S_ISDIR(st.st_mode) ? kind::directory : kind::file;
+            if(path.second == kind::directory) {
+                _push_directory(path.first);
+                continue;
+            }
+            item = std::move(path.first);
+            return true;
+        }
+#else
+        return _base->next(item); // Expansion requires glob and dirent
+#endif
+    }
+
+    void _path_source::_push_pattern(const std::string &pattern) {
+#ifdef FIRE_POSIX_
+        glob_t matches;
+        int status = glob(pattern.c_str(), 0, nullptr, &matches);
+        if(_::current_matcher().deferred_assert(identifier(), status == 0, "no files match pattern " + pattern))
+            for(size_t i = matches.gl_pathc; i > 0; --i) // Matches are sorted, first one goes to the back
+                _pending.emplace_back(matches.gl_pathv[i - 1], kind::unknown);
+        globfree(&matches);
+#else
+        (void) pattern;
+#endif
+    }
+
+    void _path_source::_push_directory(const std::string &directory) {
+#ifdef FIRE_POSIX_
+        DIR *dir = opendir(directory.c_str());
+        if(! _::current_matcher().deferred_assert(identifier(), dir != nullptr, "can't read directory " + directory))
+            return;
+
+        std::string prefix = directory.back() == '/' ? directory : directory + "/";
+        std::vector<std::pair<std::string, kind>> entries;
+        while(const dirent *entry = readdir(dir)) {
+            if(std::strcmp(entry->d_name, ".") == 0 || std::strcmp(entry->d_name, "..") == 0)
+                continue;
+            kind entry_kind = kind::unknown;
+#ifdef DT_DIR
+            if(entry->d_type == DT_DIR) // Symbolic links to directories aren't followed to avoid cycles
+                entry_kind = kind::directory;
+            else if(entry->d_type != DT_UNKNOWN)
+                entry_kind = kind::file;
+#endif
+            if(entry_kind == kind::unknown) {
+                struct stat st;
+                entry_kind = lstat((prefix + entry->d_name).c_str(), &st) == 0 && S_ISDIR(st.st_mode) ?
+                        kind::directory : kind::file;
+            }
+            entries.emplace_back(prefix + entry->d_name, entry_kind);
+        }
+        closedir(dir);
+
+        std::sort(entries.begin(), entries.end(), [](const std::pair<std::string, kind> &a,
+                                                      const std::pair<std::string, kind> &b) { return a.first > b.first; });
+        std::move(entries.begin(), entries.end(), std::back_inserter(_pending));
+#else
+        (void) directory;
+#endif
+    }
+
+
+    string_ref string_ref::_owning(std::string value) {
+        string_ref ref;
+        ref._owned = std::make_shared<const std::string>(std::move(value));
+        ref._data = ref._owned->data();
+        ref._size = ref._owned->size();
+        return ref;
+    }
+
+    string_ref string_ref::_mapped(std::shared_ptr<const _file_view> file) {
+        string_ref ref;
+        ref._file = std::move(file);
+        ref._data = ref._file->data();
+        ref._size = ref._file->size();
+        return ref;
+    }
+
+
+    _isolated_parse::_isolated_parse(const std::string &executable, const std::vector<std::string> &args,
+                                     bool space_assignment):
+            _outer_matcher(_::isolated_matcher), _outer_logger(_::isolated_logger) {
+        _::isolated_matcher = &_matcher_instance;
+        _::isolated_logger = &_logger_instance;
+
+        std::vector<const char *> argv(1, executable.c_str());
+        for(const std::string &a: args)
+            argv.push_back(a.c_str());
+
+        int main_argc = std::numeric_limits<int>::max(); // Errors are collected by finish() instead
+        bool strict = true;
+        _matcher_instance = _matcher((int) argv.size(), argv.data(), main_argc, space_assignment, strict);
+        _matcher_instance.isolate();
+    }
+
+    _isolated_parse::~_isolated_parse() {
+        _::isolated_matcher = _outer_matcher;
+        _::isolated_logger = _outer_logger;
+    }
+
+    optional<std::string> _isolated_parse::finish() {
+        _::current_matcher().check_structure();
+        return _::current_matcher().deferred_error();
+    }
+
+
+    template <typename T>
+    reloadable<T>::reloadable(std::string path, std::function<T()> parse, bool space_assignment, size_t retained):
+            _path(std::move(path)), _parse(std::move(parse)), _space_assignment(space_assignment), _retained(retained),
+            _current(nullptr) {
+        _instant_assert(retained >= 1, "reloadable must retain at least the current snapshot");
+        std::string contents, error;
+        _instant_assert(_read_file(_path, contents), "can't read options file " + _path, false);
+        _instant_assert(_publish(contents, error), error, false);
+    }
+
+    template <typename T>
+    bool reloadable<T>::reload() {
+        std::string contents, error;
+        if(! _read_file(_path, contents)) {
+            std::cerr << "Error: can't read options file " << _path << std::endl;
+            return false;
+        }
+        if(contents == _contents) // Unchanged since the last attempt
+            return false;
+
+        if(! _publish(contents, error)) {
+            std::cerr << "Error: " << error << " (keeping previous options)" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    template <typename T>
+    bool reloadable<T>::_publish(const std::string &contents, std::string &error) {
+        _contents = contents;
+
+        std::vector<std::string> args = _split_arguments(contents);
+        for(const std::string &a: args) {
+            if(a == "--")
+                break;
+            if(a.compare(0, 7, "--fire-") == 0) { // Reserved options would read files or descriptors of the service
+                error = "reserved argument " + a + " can't be used in " + _path;
+                return false;
+            }
+        }
+
+        std::unique_ptr<const T> parsed;
+        optional<std::string> parse_error;
+        {
+            _isolated_parse parse(_path, args, _space_assignment);
+            parsed.reset(new T(_parse()));
+            parse_error = parse.finish();
+        }
+
+        if(parse_error.has_value()) {
+            error = parse_error.value() + " in " + _path;
+            return false;
+        }
+
+        _current.store(parsed.get(), std::memory_order_release);
+        _snapshots.push_back(std::move(parsed));
+        if(_snapshots.size() > _retained) // Readers have had _retained - 1 reloads to finish with it
+            _snapshots.pop_front();
+        return true;
+    }
+
+    class _json_reader { // Reads JSON text, such as schemas exported with --fire-schema
+        const std::string &_text;
+        size_t _pos = 0;
+        bool _failed = false;
+
+        inline void _skip_whitespace();
+
+    public:
+        inline explicit _json_reader(const std::string &text): _text(text) {}
+
+        inline bool failed() const { return _failed; }
+        inline bool finished();
+        inline bool consume(char c);
+        inline void expect(char c);
+        inline std::string string();
+        inline optional<std::string> scalar(); // Number, boolean or string; null is returned as no value
+        inline void skip();
+    };
+
+    class validator { // Checks command lines against a schema exported with --fire-schema, without running the program
+        struct _argument {
+            optional<std::string> short_name, long_name, pos_name, def, min, max;
+            optional<int> pos;
+            std::string type;
+            bool is_optional = false;
+        };
+
+        std::string _program;
+        bool _space_assignment = true;
+        bool _response_files = false;
+        std::vector<_argument> _arguments;
+        optional<std::string> _vector_type;
+        std::string _vector_source = "positional"; // Items from "stdin" aren't positional arguments
+        bool _rest = false; // Unconsumed arguments are forwarded by the program
+
+        inline static bool _read_argument(_json_reader &reader, _argument &argument);
+        inline static bool _valid_default(const _argument &argument);
+        inline static void _declare(const _argument &argument);
+        template <typename T>
+        inline static void _convert(arg &a, const _argument &argument);
+        inline static void _check_range(const arg &a, long long value, const _argument &argument);
+        inline static void _check_range(const arg &a, long double value, const _argument &argument);
+        inline static void _check_range(const arg &, const std::string &, const _argument &) {}
+
+    public:
+        inline explicit validator(const std::string &schema);
+        inline optional<std::string> validate(const std::vector<std::string> &args) const;
+    };
+
+    void _json_reader::_skip_whitespace() {
+        while(_pos < _text.size() && isspace((unsigned char) _text[_pos]))
+            ++_pos;
+    }
+
+    bool _json_reader::finished() {
+        _skip_whitespace();
+        return _pos == _text.size();
+    }
+
+    bool _json_reader::consume(char c) {
+        _skip_whitespace();
+        if(_failed || _pos >= _text.size() || _text[_pos] != c)
+            return false;
+        ++_pos;
+        return true;
+    }
+
+    void _json_reader::expect(char c) {
+        _failed |= ! consume(c);
+    }
+
+    std::string _json_reader::string() {
+        std::string value;
+        expect('"');
+        while(! _failed && _pos < _text.size() && _text[_pos] != '"') {
+            char c = _text[_pos++];
+            if(c != '\\') {
+                value += c;
+                continue;
+            }
+            if(_pos >= _text.size())
+                break;
+            c = _text[_pos++];
+            const char *escapes = "b\bf\fn\nr\rt\t";
+            const char *escape = c == '\0' ? nullptr : std::strchr(escapes, c);
+            if(c == 'u' && _pos + 4 <= _text.size()) {
+                unsigned code = (unsigned) std::strtoul(_text.substr(_pos, 4).c_str(), nullptr, 16);
+                _pos += 4;
+                if(code < 0x80)
+                    value += (char) code;
+                else if(code < 0x800)
+                    value += {(char) (0xc0 | (code >> 6)), (char) (0x80 | (code & 0x3f))};
+                else
+                    value += {(char) (0xe0 | (code >> 12)), (char) (0x80 | ((code >> 6) & 0x3f)), (char) (0x80 | (code & 0x3f))};
+            } else if(escape != nullptr && (escape - escapes) % 2 == 0)
+                value += escape[1];
+            else
+                value += c; // \" \\ and \/
+        }
+        expect('"');
+        return value;
+    }
+
+    optional<std::string> _json_reader::scalar() {
+        _skip_whitespace();
+        if(_pos < _text.size() && _text[_pos] == '"')
+            return string();
+
+        size_t begin = _pos;
+        while(_pos < _text.size() && (isalnum((unsigned char) _text[_pos]) || std::strchr("+-.", _text[_pos])))
+            ++_pos;
+        std::string value = _text.substr(begin, _pos - begin);
+        _failed |= value.empty();
+        if(value == "null")
+            return optional<std::string>();
+        return value;
+    }
+
+    void _json_reader::skip() {
+        if(consume('{')) {
+            if(! consume('}')) {
+                do {
+                    string();
+                    expect(':');
+                    skip();
+                } while(consume(','));
+                expect('}');
+            }
+        } else if(consume('[')) {
+            if(! consume(']')) {
+                do
+                    skip();
+                while(consume(','));
+                expect(']');
+            }
+        } else
+            scalar();
+    }
+
+    validator::validator(const std::string &schema) {
+        _json_reader reader(schema);
+        bool valid = true;
+        reader.expect('{');
+        if(! reader.consume('}')) {
+            do {
+                std::string key = reader.string();
+                reader.expect(':');
+                if(key == "program")
+                    _program = reader.string();
+                else if(key == "space_assignment")
+                    _space_assignment = reader.scalar().value_or("") == "true";
+                else if(key == "response_files")
+                    _response_files = reader.scalar().value_or("") == "true";
+                else if(key == "arguments") {
+                    reader.expect('[');
+                    if(! reader.consume(']')) {
+                        do {
+                            _arguments.emplace_back();
+                            valid &= _read_argument(reader, _arguments.back());
+                        } while(reader.consume(','));
+                        reader.expect(']');
+                    }
+                } else if(key == "vector" && reader.consume('{')) {
+                    do {
+                        std::string vector_key = reader.string();
+                        reader.expect(':');
+                        if(vector_key == "type")
+                            _vector_type = reader.string();
+                        else if(vector_key == "source")
+                            _vector_source = reader.string();
+                        else
+                            reader.skip();
+                    } while(reader.consume(','));
+                    reader.expect('}');
+                } else if(key == "rest" && reader.consume('{')) {
+                    _rest = true;
+                    do {
+                        reader.string();
+                        reader.expect(':');
+                        reader.skip();
+                    } while(reader.consume(','));
+                    reader.expect('}');
+                } else
+                    reader.skip();
+            } while(reader.consume(','));
+            reader.expect('}');
+        }
+        _instant_assert(valid && ! reader.failed() && reader.finished(), "invalid argument schema");
+
+        if(_vector_type.has_value())
+            _instant_assert(_vector_type.value() == "INTEGER" || _vector_type.value() == "REAL" ||
+                            _vector_type.value() == "STRING", "invalid vector type " + _vector_type.value() + " in argument schema");
+        _instant_assert(_vector_source == "positional" || _vector_source == "stdin" || _vector_source == "paths",
+                        "invalid vector source " + _vector_source + " in argument schema");
+    }
+
+    bool validator::_read_argument(_json_reader &reader, _argument &argument) {
+        bool valid = true;
+        reader.expect('{');
+        if(! reader.consume('}')) {
+            do {
+                std::string key = reader.string();
+                reader.expect(':');
+                optional<std::string> value = reader.scalar();
+                if(key == "short")
+                    argument.short_name = value;
+                else if(key == "long")
+                    argument.long_name = value;
+                else if(key == "positional_name")
+                    argument.pos_name = value;
+                else if(key == "default")
+                    argument.def = value;
+                else if(key == "min")
+                    argument.min = value;
+                else if(key == "max")
+                    argument.max = value;
+                else if(key == "type")
+                    argument.type = value.value_or("");
+                else if(key == "optional")
+                    argument.is_optional = value.value_or("") == "true";
+                else if(key == "position" && value.has_value()) {
+                    const std::string &pos = value.value();
+                    valid &= ! pos.empty() && pos.size() <= 9 &&
+                             std::all_of(pos.begin(), pos.end(), [](char c) { return isdigit(c); });
+                    argument.pos = valid ? std::stoi(pos) : 0;
+                }
+            } while(reader.consume(','));
+            reader.expect('}');
+        }
+        return valid && _valid_default(argument);
+    }
+
+    bool validator::_valid_default(const _argument &argument) {
+        const std::string &type = argument.type;
+        if(type != "INTEGER" && type != "REAL" && type != "STRING" && type != "PATH" && type != "FLAG")
+            return false;
+        if(! argument.def.has_value() || type == "STRING" || type == "PATH")
+            return true;
+
+        std::string def = argument.def.value();
+        const char *begin = def.c_str();
+        char *end = nullptr;
+        if(type == "INTEGER")
+            (void) std::strtoll(begin, &end, 10);
+        else if(type == "REAL")
+            (void) std::strtold(begin, &end);
+        return end != nullptr && end != begin && *end == '\0';
+    }
+
+    optional<std::string> validator::validate(const std::vector<std::string> &args) const {
+        bool value = false;
+        for(const std::string &a: args) { // Expansions read files of the machine running the program
+            if(a == "--")
+                break;
+            if(_response_files && ! value && a.size() >= 2 && a[0] == '@')
+                return "argument " + a + " reads files, so it can't be validated";
+            if(a.compare(0, 7, "--fire-") == 0) // Reserved options read files, print or change how arguments are used
+                return "reserved argument " + a + " can't be validated";
+            value = _space_assignment && _may_take_value(a);
+        }
+
+        _isolated_parse parse(_program, args, _space_assignment);
+        for(const _argument &argument: _arguments)
+            _declare(argument);
+        if(_vector_type.has_value() && _vector_source != "stdin") { // Paths are checked as strings, without expanding them
+            if(_space_assignment && _::current_matcher().pos_args() > 0)
+                return std::string("positional arguments can't be used with space assignment");
+            arg a = arg::vector();
+            if(_vector_type.value() == "INTEGER")
+                (void) a.operator std::vector<long long>();
+            else if(_vector_type.value() == "REAL")
+                (void) a.operator std::vector<long double>();
+            else
+                (void) a.operator std::vector<std::string>();
+        }
+        if(_rest)
+            (void) arg::unconsumed().operator rest();
+        return parse.finish();
+    }
+
+    void validator::_declare(const _argument &argument) {
+        std::vector<std::string> names; // Environment variables of the validating process don't apply
+        for(const optional<std::string> &name: {argument.short_name, argument.long_name, argument.pos_name})
+            if(name.has_value())
+                names.push_back(name.value());
+
+        arg a;
+        a._id = identifier(names, argument.pos);
+        if(argument.type == "INTEGER")
+            _convert<long long>(a, argument);
+        else if(argument.type == "REAL")
+            _convert<long double>(a, argument);
+        else if(argument.type == "FLAG")
+            (void) (bool) a;
+        else
+            _convert<std::string>(a, argument); // Paths aren't opened, as files belong to the machine running the program
+    }
+
+    template <typename T>
+    void validator::_convert(arg &a, const _argument &argument) {
+        if(argument.def.has_value()) {
+            const std::string &def = argument.def.value();
+            if(std::is_integral<T>::value)
+                a._int_value = std::stoll(def);
+            else if(std::is_floating_point<T>::value)
+                a._float_value = std::stold(def);
+            else
+                a._string_value = def;
+            T value = a;
+            _check_range(a, value, argument);
+        } else if(argument.is_optional) {
+            optional<T> value = a;
+            if(value.has_value())
+                _check_range(a, value.value(), argument);
+        } else {
+            T value = a;
+            _check_range(a, value, argument);
+        }
+    }
+
+    void validator::_check_range(const arg &a, long long value, const _argument &argument) {
+        if(! argument.min.has_value() || ! argument.max.has_value()) // Schemas without ranges only check the type
+            return;
+        long long min = std::strtoll(argument.min.value().c_str(), nullptr, 10);
+        unsigned long long max = std::strtoull(argument.max.value().c_str(), nullptr, 10);
+        _::current_matcher().deferred_assert(a._id, min < 0 || value >= 0, "argument " + a._id.help() + " must be positive");
+        _::current_matcher().deferred_assert(a._id, min <= value && (value < 0 || (unsigned long long) value <= max),
+                                             "value " + std::to_string(value) + " out of range");
+    }
+
+    void validator::_check_range(const arg &a, long double value, const _argument &argument) {
+        if(! argument.min.has_value() || ! argument.max.has_value())
+            return;
+        long double min = std::strtold(argument.min.value().c_str(), nullptr);
+        long double max = std::strtold(argument.max.value().c_str(), nullptr);
+        _::current_matcher().deferred_assert(a._id, min <= value && value <= max,
+                                             "value " + std::to_string(value) + " out of range");
+    }
+
+    class argv_builder { // Builds a command line for a fire program from typed values, in one contiguous buffer
+        struct _entry {
+            size_t offset;
+            bool named;
+            int pos; // Vector items follow positional arguments
+        };
+
+        std::vector<char> _buffer; // Arguments separated by null characters
+        std::vector<_entry> _entries;
+        std::vector<char *> _argv;
+        size_t _separator_offset = 0;
+        bool _separator = false; // Positional argument starts with a hyphen
+
+        inline void _append_value(const std::string &value) { _buffer.insert(_buffer.end(), value.begin(), value.end()); }
+        inline void _append_value(const char *value) { _buffer.insert(_buffer.end(), value, value + std::strlen(value)); }
+        template <typename T, typename std::enable_if<std::is_integral<T>::value && ! std::is_same<T, bool>::value>::type* = nullptr>
+        inline void _append_value(T value);
+        template <typename T, typename std::enable_if<std::is_floating_point<T>::value>::type* = nullptr>
+        inline void _append_value(T value);
+        template <typename T>
+        inline void _add_positional(int pos, const T &value);
+        inline void _begin_named(const identifier &id);
+        inline void _end_entry() { _buffer.push_back('\0'); }
+
+    public:
+        inline explicit argv_builder(const std::string &executable);
+
+        template <typename T>
+        inline argv_builder & add(const arg &a, const T &value);
+        template <typename T>
+        inline argv_builder & add(const arg &a, const optional<T> &value);
+        template <typename T>
+        inline argv_builder & add(const arg &a, const std::vector<T> &values);
+        inline argv_builder & add(const arg &a, bool flag);
+
+        inline size_t argc() const { return 1 + _entries.size() + _separator; }
+        inline char * const * argv(); // Null-terminated, valid until the builder is modified
+    };
+
+    argv_builder::argv_builder(const std::string &executable) {
+        _append_value(executable);
+        _end_entry();
+        _separator_offset = _buffer.size();
+        _append_value("--");
+        _end_entry();
+    }
+
+    template <typename T, typename std::enable_if<std::is_integral<T>::value && ! std::is_same<T, bool>::value>::type*>
+    void argv_builder::_append_value(T value) {
+        char digits[32];
+        int size = std::is_signed<T>::value ? std::snprintf(digits, sizeof(digits), "%lld", (long long) value) :
+                                              std::snprintf(digits, sizeof(digits), "%llu", (unsigned long long) value);
+        _buffer.insert(_buffer.end(), digits, digits + size);
+    }
+
+    template <typename T, typename std::enable_if<std::is_floating_point<T>::value>::type*>
+    void argv_builder::_append_value(T value) {
+        char digits[64]; // Enough digits to read back the same value
+        int size = std::snprintf(digits, sizeof(digits), "%.*Lg", std::numeric_limits<T>::max_digits10, (long double) value);
+        _buffer.insert(_buffer.end(), digits, digits + size);
+    }
+
+    void argv_builder::_begin_named(const identifier &id) {
+        _entries.push_back({_buffer.size(), true, 0});
+        _append_value(id.longer());
+    }
+
+    template <typename T>
+    void argv_builder::_add_positional(int pos, const T &value) {
+        _entries.push_back({_buffer.size(), false, pos});
+        _append_value(value);
+        size_t offset = _entries.back().offset;
+        bool hyphen = _buffer.size() > offset && _buffer[offset] == '-';
+        bool number = _buffer.size() > offset + 1 && isdigit((unsigned char) _buffer[offset + 1]);
+        bool response_file = _buffer.size() > offset + 1 && _buffer[offset] == '@'; // Children may expand "@path"
+        _separator |= (hyphen && ! number) || response_file; // Negative numbers are positional anyway
+        _end_entry();
+    }
+
+    template <typename T>
+    argv_builder & argv_builder::add(const arg &a, const T &value) {
+        _instant_assert(! a._id.vector(), "vector arguments must be given as std::vector");
+        if(a._id.get_pos().has_value())
+            _add_positional(a._id.get_pos().value(), value);
+        else {
+            _begin_named(a._id);
+            _buffer.push_back('=');
+            _append_value(value);
+            _end_entry();
+        }
+        return *this;
+    }
+
+    template <typename T>
+    argv_builder & argv_builder::add(const arg &a, const optional<T> &value) {
+        if(value.has_value())
+            add(a, value.value());
+        return *this;
+    }
+
+    template <typename T>
+    argv_builder & argv_builder::add(const arg &a, const std::vector<T> &values) {
+        _instant_assert(a._id.vector(), "std::vector values must be given for arg::vector()");
+        for(const T &value: values)
+            _add_positional(std::numeric_limits<int>::max(), value);
+        return *this;
+    }
+
+    argv_builder & argv_builder::add(const arg &a, bool flag) {
+        _instant_assert(! a._id.vector() && ! a._id.get_pos().has_value(), "flag " + a._id.longer() + " must be named");
+        if(flag) {
+            _begin_named(a._id);
+            _end_entry();
+        }
+        return *this;
+    }
+
+    char * const * argv_builder::argv() {
+        std::vector<_entry> positional;
+        _argv.assign(1, _buffer.data());
+        for(const _entry &entry: _entries) {
+            if(entry.named)
+                _argv.push_back(_buffer.data() + entry.offset);
+            else
+                positional.push_back(entry);
+        }
+
+        std::stable_sort(positional.begin(), positional.end(), [](const _entry &a, const _entry &b) { return a.pos < b.pos; });
+        if(_separator)
+            _argv.push_back(_buffer.data() + _separator_offset);
+        for(const _entry &entry: positional)
+            _argv.push_back(_buffer.data() + entry.offset);
+        _argv.push_back(nullptr);
+        return _argv.data();
+    }
+
+    class _subcommands { // Entry functions of programs with several commands, selected by name
+    public:
+        using entry = int (*)(int argc, const char **argv);
+
+        struct registrar { // Registers a command during static initialization
+            registrar(const std::string &name, entry main_func) { add(name, main_func); }
+        };
+
+        inline static void add(const std::string &name, entry main_func);
+        inline static int run(int argc, const char **argv);
+        inline static int run_multicall(int argc, const char **argv);
+        inline static std::string completion(const std::string &executable, const std::string &shell);
+
+    private:
+        inline static std::unordered_map<std::string, entry> & _registry();
+        inline static void _print_commands(const std::string &executable);
+        inline static int _complete(int argc, const char **argv);
+    };
+
+    std::unordered_map<std::string, _subcommands::entry> & _subcommands::_registry() {
+        static std::unordered_map<std::string, entry> registry; // Constructed on first use by static registrations
+        return registry;
+    }
+
+    void _subcommands::add(const std::string &name, entry main_func) {
+        _instant_assert(_registry().emplace(name, main_func).second, "command " + name + " defined more than once");
+    }
+
+    int _subcommands::run(int argc, const char **argv) {
+        std::string name = argc >= 2 ? argv[1] : "";
+        if(name == "--fire-complete" && argc >= 4) // Words are: program command options...
+            return _complete(argc, argv);
+        for(int i = 1; i < argc && std::string(argv[i]) != "--"; ++i) { // Script covers all commands, wherever it's asked
+            std::string option = argv[i];
+            if(option.compare(0, 18, "--fire-completion=") == 0 || (option == "--fire-completion" && i + 1 < argc)) {
+                std::cout << completion(argv[0], option.size() > 18 ? option.substr(18) : argv[i + 1]);
+                return 0;
+            }
+        }
+        auto it = _registry().find(name);
+        if(it == _registry().end()) {
+            _print_commands(argv[0]);
+            _instant_assert(name == "-h" || name == "--help", name.empty() ? "no command given" : "unknown command " + name, false);
+            exit(0);
+        }
+
+        std::string executable = std::string(argv[0]) + " " + name; // Shown in usage of the command
+        std::vector<const char *> command_argv(1, executable.c_str());
+        command_argv.insert(command_argv.end(), argv + 2, argv + argc);
+        command_argv.push_back(nullptr);
+        return it->second(argc - 1, command_argv.data());
+    }
+
+    int _subcommands::run_multicall(int argc, const char **argv) {
+        std::string name = argv[0];
+        size_t separator = name.find_last_of("/\\");
+        if(separator != std::string::npos)
+            name = name.substr(separator + 1);
+        if(name.size() > 4 && name.compare(name.size() - 4, 4, ".exe") == 0)
+            name.resize(name.size() - 4);
+
+        auto it = _registry().find(name);
+        if(it != _registry().end())
+            return it->second(argc, argv);
+        return run(argc, argv); // Invoked by the binary's own name, so the command is given as the first argument
+    }
+
+    std::string _subcommands::completion(const std::string &executable, const std::string &shell) {
+        _help_logger::check_shell(shell);
+        std::vector<std::string> names;
+        for(const auto &it: _registry())
+            names.push_back(it.first);
+        std::sort(names.begin(), names.end());
+
+        std::vector<std::pair<std::string, _help_logger>> commands; // Declarations of each command, none of them run
+        std::string option = "--fire-completion=" + shell;
+        _::declarations_only = true;
+        for(const std::string &name: names) {
+            std::string command = executable + " " + name;
+            const char *argv[] = {command.c_str(), option.c_str(), nullptr};
+            try {
+                _registry()[name](2, argv);
+            } catch(const _declared &) {
+            }
+            commands.emplace_back(name, _::help_logger);
+        }
+        _::declarations_only = false;
+        return _help_logger::completion(shell, executable, commands);
+    }
+
+    int _subcommands::_complete(int argc, const char **argv) {
+        int index = std::atoi(argv[2]);
+        std::string command = argc >= 5 ? argv[4] : "";
+        if(index <= 1) { // Completing the command itself
+            std::vector<std::string> names;
+            for(const auto &it: _registry())
+                if(it.first.compare(0, command.size(), command) == 0)
+                    names.push_back(it.first);
+            std::sort(names.begin(), names.end());
+            for(const std::string &name: names)
+                std::cout << name << "\n";
+            return 0;
+        }
+
+        auto it = _registry().find(command);
+        if(it == _registry().end())
+            return 0;
+
+        std::string executable = std::string(argv[0]) + " " + command;
+        std::string command_index = std::to_string(index - 1);
+        std::vector<const char *> command_argv = {executable.c_str(), argv[1], command_index.c_str()};
+        command_argv.insert(command_argv.end(), argv + 4, argv + argc); // Command becomes the first word
+        command_argv.push_back(nullptr);
+        return it->second((int) command_argv.size() - 1, command_argv.data());
+    }
+
+    void _subcommands::_print_commands(const std::string &executable) {
+        std::vector<std::string> names;
+        for(const auto &it: _registry())
+            names.push_back(it.first);
+        std::sort(names.begin(), names.end());
+
+        std::string commands = "    Commands:\n";
+        for(const std::string &name: names)
+            commands += "      " + name + "\n";
+        std::cerr << std::endl << "    Usage:\n      " << executable << " COMMAND [ARGUMENTS]" << std::endl
+                  << std::endl << std::endl << commands << std::endl;
+    }
 }
 
 
@@ -838,7 +3159,8 @@ void init_and_run(int argc, const char ** argv, F main_func, bool space_assignme
     int main_argc = (int) fire::_get_argument_count(main_func);
     bool strict = true;
     fire::_::help_logger = fire::_help_logger();
-    fire::_::matcher = fire::_matcher(argc, argv, main_argc, space_assignment, strict);
+    fire::_::matcher = fire::_matcher(argc, argv, main_argc, space_assignment, strict, fire::_response_files);
+    fire::_::current_matcher().fail_fast();
 }
 
 #define FIRE(fired_main) \
@@ -855,4 +3177,28 @@ int main(int argc, const char ** argv) {\
     return fired_main();\
 }
 
+#define FIRE_SUBCOMMAND(fired_main) \
+static fire::_subcommands::registrar fire_subcommand_##fired_main(#fired_main, [](int argc, const char ** argv) {\
+    bool space_assignment = true;\
+    init_and_run(argc, argv, fired_main, space_assignment);\
+    return fired_main();\
+});
+
+#define FIRE_SUBCOMMAND_NO_SPACE_ASSIGNMENT(fired_main) \
+static fire::_subcommands::registrar fire_subcommand_##fired_main(#fired_main, [](int argc, const char ** argv) {\
+    bool space_assignment = false;\
+    init_and_run(argc, argv, fired_main, space_assignment);\
+    return fired_main();\
+});
+
+#define FIRE_SUBCOMMANDS() \
+int main(int argc, const char ** argv) {\
+    return fire::_subcommands::run(argc, argv);\
+}
+
+#define FIRE_MULTICALL() \
+int main(int argc, const char ** argv) {\
+    return fire::_subcommands::run_multicall(argc, argv);\
+}
+
 #endif
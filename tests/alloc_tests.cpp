@@ -0,0 +1,169 @@
+
+/*
+    Copyright Kristjan Kongas 2020
+
+    Boost Software License - Version 1.0 - August 17th, 2003
+
+    Permission is hereby granted, free of charge, to any person or organization
+    obtaining a copy of the software and accompanying documentation covered by
+    this license (the "Software") to use, reproduce, display, distribute,
+    execute, and transmit the Software, and to prepare derivative works of the
+    Software, and to permit third-parties to whom the Software is furnished to
+    do so, all subject to the following:
+
+    The copyright notices in the Software and this entire statement, including
+    the above license grant, this restriction and the following disclaimer,
+    must be included in all copies of the Software, in whole or in part, and
+    all derivative works of the Software, unless such copies or derivative
+    works are solely in the form of machine-executable object code generated by
+    a source language processor.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+    SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+    FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+*/
+
+// Heap allocations of typical parses, counted by replacing global operator new and delete. Budgets are about
+// 25% over the measured counts, so exceeding one indicates a regression rather than noise.
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <gtest/gtest.h>
+#include "../fire.hpp"
+
+using namespace std;
+using namespace fire;
+
+struct allocation_count {
+    size_t allocations;
+    size_t bytes;
+};
+
+static allocation_count total = {0, 0};
+
+#if defined(__GNUC__) && ! defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push // Replacements pair malloc with free, which GCC can't see through once they're inlined
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void * operator new(size_t size) {
+    ++total.allocations;
+    total.bytes += size;
+    if(void *ptr = malloc(size ? size : 1))
+        return ptr;
+    throw bad_alloc();
+}
+
+void * operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    free(ptr);
+}
+
+#ifdef __cpp_sized_deallocation
+void operator delete(void *ptr, size_t) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept {
+    free(ptr);
+}
+#endif
+
+#if defined(__GNUC__) && ! defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+class null_buffer: public streambuf { // Discards output without allocating
+protected:
+    int overflow(int c) override { return c; }
+};
+
+class command_line { // Built before counting starts
+    vector<string> _strings;
+    vector<const char *> _argv;
+
+public:
+    explicit command_line(vector<string> strings): _strings(move(strings)) {
+        for(const string &s: _strings)
+            _argv.push_back(s.c_str());
+    }
+    int argc() const { return (int) _argv.size(); }
+    const char ** argv() { return _argv.data(); }
+};
+
+template <typename F>
+allocation_count count_allocations(const string &name, size_t budget, F parse) {
+    allocation_count start = total; // Counted with the real environment, which isn't indexed unless needed
+    parse();
+    allocation_count used = {total.allocations - start.allocations, total.bytes - start.bytes};
+    printf("[ ALLOCS   ] %s: %zu allocations (budget %zu), %zu bytes\n", name.c_str(), used.allocations, budget, used.bytes);
+    EXPECT_LE(used.allocations, budget);
+    return used;
+}
+
+void init(command_line &args, int main_argc, bool space_assignment) {
+    bool strict = true;
+    _::help_logger = _help_logger();
+    _::matcher = _matcher(args.argc(), args.argv(), main_argc, space_assignment, strict);
+}
+
+void declare_scalars() {
+    int i = arg({"-i", "--integer", "An integer"}, 1);
+    double r = arg({"-r", "--real", "A real number"}, 0.5);
+    string s = arg({"-s", "--string", "A string"}, "text");
+    fire::optional<int> o = arg({"-o", "--optional", "An optional integer"});
+    (void) i; (void) r; (void) s; (void) o;
+}
+
+TEST(allocations, flags) {
+    command_line args({"./alloc_tests", "-a", "--beta"});
+    count_allocations("flags", 170, [&] {
+        init(args, 3, true);
+        EXPECT_TRUE((bool) arg("-a"));
+        EXPECT_TRUE((bool) arg({"-b", "--beta"}));
+        EXPECT_FALSE((bool) arg("-c"));
+    });
+}
+
+TEST(allocations, scalars_with_defaults) {
+    command_line args({"./alloc_tests", "-i=3", "--real=2.5"});
+    count_allocations("scalars with defaults", 310, [&] {
+        init(args, 4, true);
+        declare_scalars();
+    });
+}
+
+TEST(allocations, positional_strings) {
+    vector<string> strings = {"./alloc_tests"};
+    for(int i = 0; i < 10000; ++i)
+        strings.push_back("input_" + to_string(i) + ".txt");
+    command_line args(strings);
+    count_allocations("10k positional strings", 12600, [&] {
+        init(args, 1, false);
+        vector<string> all = arg::vector();
+        EXPECT_EQ(all.size(), (size_t) 10000);
+    });
+}
+
+TEST(allocations, help) {
+    command_line args({"./alloc_tests"});
+    init(args, numeric_limits<int>::max(), true);
+    declare_scalars();
+
+    null_buffer discard;
+    streambuf *cerr_buffer = cerr.rdbuf(&discard);
+    count_allocations("help", 40, [] { _::help_logger.print_help(); });
+    cerr.rdbuf(cerr_buffer);
+}
@@ -0,0 +1,192 @@
+
+/*
+    Copyright Kristjan Kongas 2020
+
+    Boost Software License - Version 1.0 - August 17th, 2003
+
+    Permission is hereby granted, free of charge, to any person or organization
+    obtaining a copy of the software and accompanying documentation covered by
+    this license (the "Software") to use, reproduce, display, distribute,
+    execute, and transmit the Software, and to prepare derivative works of the
+    Software, and to permit third-parties to whom the Software is furnished to
+    do so, all subject to the following:
+
+    The copyright notices in the Software and this entire statement, including
+    the above license grant, this restriction and the following disclaimer,
+    must be included in all copies of the Software, in whole or in part, and
+    all derivative works of the Software, unless such copies or derivative
+    works are solely in the form of machine-executable object code generated by
+    a source language processor.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+    SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+    FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+*/
+
+// Microbenchmarks for parser phases on synthetic command lines. Not run by ctest, build with
+// -DCMAKE_BUILD_TYPE=Release for meaningful results. Each case reports the fastest of its runs.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include "../fire.hpp"
+
+using namespace std;
+using namespace fire;
+
+class command_line { // Keeps argv pointers valid for the lifetime of the strings
+    vector<string> _strings;
+    vector<const char *> _argv;
+
+public:
+    explicit command_line(vector<string> strings): _strings(move(strings)) {
+        for(const string &s: _strings)
+            _argv.push_back(s.c_str());
+    }
+    int argc() const { return (int) _argv.size(); }
+    const char ** argv() { return _argv.data(); }
+};
+
+string option_name(size_t i) {
+    return "--option" + to_string(i);
+}
+
+command_line positional_args(size_t n) {
+    vector<string> args = {"./fire_bench"};
+    for(size_t i = 0; i < n; ++i)
+        args.push_back(to_string(i));
+    return command_line(args);
+}
+
+command_line named_args(size_t n) {
+    vector<string> args = {"./fire_bench"};
+    for(size_t i = 0; i < n; ++i)
+        args.push_back(option_name(i) + "=" + to_string(i));
+    return command_line(args);
+}
+
+void init(command_line &args, bool space_assignment, bool response_files = false) {
+    int main_argc = numeric_limits<int>::max(); // Final check is never reached
+    bool strict = true;
+    _::help_logger = _help_logger();
+    _::matcher = _matcher(args.argc(), args.argv(), main_argc, space_assignment, strict, response_files);
+}
+
+void write_response_file(const string &path, size_t n) {
+    ofstream file(path);
+    for(size_t i = 0; i < n; ++i)
+        file << i << '\n';
+}
+
+void query_all(size_t n) {
+    for(size_t i = 0; i < n; ++i)
+        (void) (int) arg(option_name(i).c_str());
+}
+
+vector<size_t> sizes(size_t max) {
+    vector<size_t> result;
+    for(size_t n = 1; n <= max; n *= 10)
+        result.push_back(n);
+    return result;
+}
+
+void measure(const string &phase, size_t n, int min_time_ms,
+             const function<void()> &setup, const function<void()> &run) {
+    using clock = chrono::steady_clock;
+    clock::duration total(0), best = clock::duration::max();
+    int runs = 0;
+    while(runs == 0 || total < chrono::milliseconds(min_time_ms)) {
+        setup();
+        clock::time_point start = clock::now();
+        run();
+        clock::duration elapsed = clock::now() - start;
+        total += elapsed;
+        best = min(best, elapsed);
+        ++runs;
+    }
+
+    double ns = (double) chrono::duration_cast<chrono::nanoseconds>(best).count();
+    printf("%-22s %9zu %7d %14.3f %12.1f\n", phase.c_str(), n, runs, ns / 1e6, ns / (double) n);
+    fflush(stdout);
+}
+
+int fired_main(int max_argv = arg({"--max-argv", "Largest number of synthetic arguments"}, 1000000),
+               int max_options = arg({"--max-options", "Largest number of declared options"}, 10000),
+               int min_time = arg({"--min-time", "Measuring time per case in milliseconds"}, 200)) {
+    printf("%-22s %9s %7s %14s %12s\n", "phase", "n", "runs", "best [ms]", "ns per item");
+
+    for(size_t n: sizes((size_t) max_argv)) {
+        command_line args = positional_args(n);
+        measure("construct", n, min_time, []{}, [&] { init(args, false); });
+    }
+
+    for(size_t n: sizes((size_t) max_argv)) {
+        command_line args = positional_args(n);
+        _matcher matcher;
+        measure("tokenize", n, min_time, [&] { matcher = _matcher(); },
+                [&] { matcher.parse(args.argc(), args.argv()); });
+    }
+
+    string path = "fire_bench_response.args";
+    for(size_t n: sizes((size_t) max_argv)) {
+        write_response_file(path, n);
+        command_line args({"./fire_bench", "@" + path});
+        measure("response_file", n, min_time, []{}, [&] { init(args, false, true); });
+    }
+
+    for(size_t n: sizes((size_t) max_argv)) { // Files under _min_cached_response_file are never cached
+        write_response_file(path, n);
+        vector<string> tokens;
+        measure("response_tokenize", n, min_time, []{}, [&] { _read_response_file(path, tokens, false); });
+        _read_response_file(path, tokens, true);
+        measure("response_token_cache", n, min_time, []{}, [&] { _read_response_file(path, tokens, true); });
+    }
+    remove(path.c_str());
+    remove((path + ".fire-cache").c_str());
+
+    for(size_t n: sizes((size_t) max_options)) {
+        command_line args = named_args(n);
+        vector<identifier> ids;
+        for(size_t i = 0; i < n; ++i)
+            ids.emplace_back(vector<string>{option_name(i)}, optional<int>());
+        measure("get_and_mark_queried", n, min_time, [&] { init(args, true); },
+                [&] { for(const identifier &id: ids) (void) _::matcher.get_and_mark_as_queried(id); });
+    }
+
+    for(size_t n: sizes((size_t) max_options)) {
+        command_line args = named_args(n);
+        measure("scalar_conversion", n, min_time, [&] { init(args, true); }, [&] { query_all(n); });
+    }
+
+    for(size_t n: sizes((size_t) max_argv)) {
+        command_line args = positional_args(n);
+        measure("vector_conversion", n, min_time, [&] { init(args, false); },
+                [] { vector<int> all = arg::vector(); (void) all; });
+    }
+
+    for(size_t n: sizes((size_t) max_options)) {
+        command_line args = named_args(n);
+        measure("strict_validation", n, min_time, [&] { init(args, true); query_all(n); },
+                [] { _::matcher.check_named(); _::matcher.check_positional(); });
+    }
+
+    for(size_t n: sizes((size_t) max_options)) {
+        command_line args = named_args(n);
+        ostringstream help;
+        streambuf *cerr_buffer = cerr.rdbuf(help.rdbuf());
+        measure("help", n, min_time, [&] { init(args, true); query_all(n); help.str(""); },
+                [] { _::help_logger.print_help(); });
+        cerr.rdbuf(cerr_buffer);
+    }
+
+    return 0;
+}
+
+FIRE(fired_main)
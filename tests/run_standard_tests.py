@@ -27,7 +27,7 @@
     DEALINGS IN THE SOFTWARE.
 """
 
-import subprocess, sys, json
+import subprocess, sys, json, os
 import run_examples
 from pathlib import Path
 
@@ -59,6 +59,8 @@ def get_path_prefix(subdir):
 def main():
     cur_dir, path_prefix = get_path_prefix("run_tests")
     run(path_prefix / "run_tests")
+    if os.name == "posix": # Allocation tests are built only on Unix
+        run(path_prefix / "alloc_tests")
     run_examples.main()
     run(path_prefix / "link_test")
     print_result(True)
@@ -0,0 +1,90 @@
+
+"""
+    Copyright Kristjan Kongas 2020
+
+    Boost Software License - Version 1.0 - August 17th, 2003
+
+    Permission is hereby granted, free of charge, to any person or organization
+    obtaining a copy of the software and accompanying documentation covered by
+    this license (the "Software") to use, reproduce, display, distribute,
+    execute, and transmit the Software, and to prepare derivative works of the
+    Software, and to permit third-parties to whom the Software is furnished to
+    do so, all subject to the following:
+
+    The copyright notices in the Software and this entire statement, including
+    the above license grant, this restriction and the following disclaimer,
+    must be included in all copies of the Software, in whole or in part, and
+    all derivative works of the Software, unless such copies or derivative
+    works are solely in the form of machine-executable object code generated by
+    a source language processor.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+    SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+    FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+"""
+
+# Measures exec-to-exit latency of the example programs. An empty program (startup_baseline) is measured too,
+# so the time added by the library is the difference to the baseline. Build with -DCMAKE_BUILD_TYPE=Release.
+
+import argparse, statistics, subprocess, time
+from run_examples import get_path_prefix
+
+cases = [
+    ("startup_baseline", "run_tests", ""),
+    ("basic", "examples", "-x 3 -y 4"),
+    ("basic", "examples", "--help"),
+    ("flag", "examples", "-a -b"),
+    ("optional_and_default", "examples", "--optional -1 --default 1"),
+    ("positional", "examples", "2 3"),
+    ("vector_positional", "examples", "b a -s"),
+    ("vector_positional", "examples", " ".join(str(i) for i in range(10000))),
+    ("all_combinations", "examples", "0 1 -i=0 --def-r=0.0 --opt-s=string"),
+    ("subcommands", "examples", "add -x 3 -y 4"),
+]
+
+
+def measure(cmd, runs, warmup):
+    latencies = []
+    for i in range(warmup + runs):
+        start = time.perf_counter()
+        result = subprocess.run(cmd, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+        elapsed = time.perf_counter() - start
+        assert result.returncode == 0, "{} failed with code {}".format(cmd[0], result.returncode)
+        if i >= warmup:
+            latencies.append(elapsed * 1e6)
+    return sorted(latencies)
+
+
+def percentile(latencies, p):
+    return latencies[min(len(latencies) - 1, int(p / 100 * len(latencies)))]
+
+
+def describe(args):
+    return args if len(args) <= 30 else "<{} arguments>".format(len(args.split()))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Measure process startup latency of example programs")
+    parser.add_argument("--runs", type=int, default=200, help="measured runs per case")
+    parser.add_argument("--warmup", type=int, default=10, help="unmeasured runs per case")
+    args = parser.parse_args()
+
+    print("{:<22} {:<30} {:>9} {:>9} {:>9} {:>9} {:>11}".format(
+        "program", "arguments", "min [us]", "p50", "p90", "p99", "p50 - base"))
+    baseline = None
+    for name, subdir, cmd_args in cases:
+        cmd = [str(get_path_prefix(subdir) / name)] + cmd_args.split()
+        latencies = measure(cmd, args.runs, args.warmup)
+        p50 = statistics.median(latencies)
+        if baseline is None:
+            baseline = p50
+        print("{:<22} {:<30} {:>9.0f} {:>9.0f} {:>9.0f} {:>9.0f} {:>11.0f}".format(
+            name, describe(cmd_args), latencies[0], p50, percentile(latencies, 90), percentile(latencies, 99), p50 - baseline))
+
+
+if __name__ == "__main__":
+    main()
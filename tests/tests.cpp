@@ -27,6 +27,9 @@
     DEALINGS IN THE SOFTWARE.
 */
 
+#include <chrono>
+#include <fstream>
+#include <thread>
 #include <gtest/gtest.h>
 #include "../fire.hpp"
 
@@ -36,13 +39,14 @@
 using namespace std;
 using namespace fire;
 
-void init_args(const vector<string> &args, bool space_assignment, bool strict, int named_calls = 1000000) {
+void init_args(const vector<string> &args, bool space_assignment, bool strict, int named_calls = 1000000,
+               bool response_files = false) {
     const char ** argv = new const char *[args.size()];
     for(size_t i = 0; i < args.size(); ++i)
         argv[i] = args[i].c_str();
 
     fire::_::help_logger = fire::_help_logger();
-    fire::_::matcher = fire::_matcher((int) args.size(), argv, named_calls, space_assignment, strict);
+    fire::_::matcher = fire::_matcher((int) args.size(), argv, named_calls, space_assignment, strict, response_files);
 
     delete [] argv;
 }
@@ -63,6 +67,40 @@ void init_args_no_space_strict(const vector<string> &args, int named_calls) {
     init_args(args, false, true, named_calls);
 }
 
+void init_args_response_files(const vector<string> &args, bool space_assignment = false) {
+    init_args(args, space_assignment, false, 1000000, true);
+}
+
+void set_env(const string &name, const string &value) {
+#ifdef _WIN32
+    _putenv_s(name.c_str(), value.c_str());
+#else
+    setenv(name.c_str(), value.c_str(), 1);
+#endif
+}
+
+void unset_env(const string &name) {
+#ifdef _WIN32
+    _putenv_s(name.c_str(), "");
+#else
+    unsetenv(name.c_str());
+#endif
+}
+
+bool reopen_stdin(const string &path) {
+#ifdef _WIN32
+    FILE *file = nullptr;
+    return freopen_s(&file, path.c_str(), "rb", stdin) == 0;
+#else
+    return freopen(path.c_str(), "rb", stdin) != nullptr;
+#endif
+}
+
+void write_file(const string &path, const string &contents) {
+    ofstream file(path, ios::binary);
+    file << contents;
+}
+
 
 
 TEST(optional, value) {
@@ -250,6 +288,24 @@ TEST(matcher, invalid_input) {
     EXPECT_EXIT_FAIL(init_args({"./run_tests", "--name=abc",  "--name=bcd"}));
 }
 
+TEST(matcher, fail_fast) {
+    init_args_strict({"./run_tests", "-x=1", "-x=2"}, 1); // Found once -x is known not to be forwarded
+    EXPECT_EXIT((void) (int) arg("-x"), ::testing::ExitedWithCode(fire::_failure_code), "multiple occurrences");
+    init_args_strict({"./run_tests", "-x=1", "-x=2", "--help"}, 1);
+    fire::_::matcher.fail_fast(); // Help is still printed for invalid command lines
+    EXPECT_TRUE(fire::_::matcher.skip_conversions());
+
+    init_args_strict({"./run_tests", "-x=1"}, 1);
+    fire::_::matcher.fail_fast();
+    EXPECT_FALSE(fire::_::matcher.skip_conversions());
+
+    // Unknown arguments are found before the last argument is converted
+    init_args_no_space_strict({"./run_tests", "--unknown", "x"}, 1);
+    EXPECT_EXIT(vector<int> all = arg::vector(), ::testing::ExitedWithCode(fire::_failure_code), "invalid argument --unknown");
+    init_args_no_space_strict({"./run_tests", "0", "x", "y"}, 1);
+    EXPECT_EXIT(vector<int> all = arg::vector(), ::testing::ExitedWithCode(fire::_failure_code), "value x is not an integer");
+}
+
 TEST(matcher, boolean_flags) {
     init_args({"./run_tests", "-a", "-bcd"});
     EXPECT_TRUE((bool) arg("-a"));
@@ -267,6 +323,132 @@ TEST(matcher, equations) {
     EXPECT_EXIT_FAIL(init_args({"./run_tests", "-a=b", "123"}));
 }
 
+TEST(matcher, response_files) {
+    write_file("response.args", "-x=1\n'with space' @response_nested.args\n");
+    write_file("response_nested.args", "\"nested\" -- @literal");
+    write_file("response_empty.args", "");
+    write_file("response_loop.args", "@response_loop.args");
+
+    init_args_response_files({"./run_tests", "@response_empty.args", "@response.args", "last"});
+    EXPECT_EQ((int) arg("-x"), 1);
+    vector<string> all0 = arg::vector();
+    EXPECT_EQ(all0, vector<string>({"with space", "nested", "@literal", "last"}));
+
+    init_args_response_files({"./run_tests", "--", "@response.args", "@"});
+    vector<string> all1 = arg::vector();
+    EXPECT_EQ(all1, vector<string>({"@response.args", "@"}));
+
+    string large;
+    for(int i = 0; i < 100000; ++i)
+        large += to_string(i) + (i % 2 ? "\n" : " ");
+    write_file("response_large.args", large);
+    init_args_response_files({"./run_tests", "-x", "@response_large.args"});
+    vector<int> all2 = arg::vector();
+    ASSERT_EQ(all2.size(), 100000u);
+    EXPECT_EQ(all2.back(), 99999);
+
+    EXPECT_EXIT_FAIL(init_args_response_files({"./run_tests", "@nonexistent.args"}));
+    EXPECT_EXIT_FAIL(init_args_response_files({"./run_tests", "@response_loop.args"}));
+
+    init_args_no_space({"./run_tests", "@response.args"}); // Expansion is opt-in
+    vector<string> all3 = arg::vector();
+    EXPECT_EQ(all3, vector<string>({"@response.args"}));
+
+    init_args({"./run_tests", "--opt", "@literal"});
+    EXPECT_EQ((string) arg("--opt"), "@literal");
+    write_file("response_named.args", "-x=1");
+    init_args_response_files({"./run_tests", "--opt", "@literal", "@response_named.args"}, true);
+    EXPECT_EQ((string) arg("--opt"), "@literal"); // Values of named arguments aren't expanded
+    EXPECT_EQ((int) arg("-x"), 1);
+}
+
+#ifdef FIRE_POSIX_
+TEST(matcher, response_file_cache) {
+    remove("response_cached.args.fire-cache");
+    string large = "'first token' ";
+    for(int i = 0; i < 20000; ++i)
+        large += to_string(i) + "\n";
+    write_file("response_cached.args", large);
+    vector<string> expected = _split_arguments(large), args;
+
+    ASSERT_TRUE(_read_response_file("response_cached.args", args, true)); // Tokenized, then cached
+    EXPECT_EQ(args, expected);
+    ifstream written("response_cached.args.fire-cache", ios::binary);
+    string cache((istreambuf_iterator<char>(written)), istreambuf_iterator<char>());
+    ASSERT_EQ(cache.substr(0, 8), "FIRETOK1");
+
+    cache.back() = 'x'; // Cached tokens are used as they are
+    write_file("response_cached.args.fire-cache", cache);
+    ASSERT_TRUE(_read_response_file("response_cached.args", args, true));
+    EXPECT_EQ(args.back(), "1999x");
+    EXPECT_TRUE(_read_response_file("response_cached.args", args, false));
+    EXPECT_EQ(args, expected);
+
+    write_file("response_cached.args", large + "last"); // New size and mtime
+    ASSERT_TRUE(_read_response_file("response_cached.args", args, true));
+    EXPECT_EQ(args.back(), "last");
+    write_file("response_cached.args.fire-cache", cache.substr(0, 50)); // Truncated
+    ASSERT_TRUE(_read_response_file("response_cached.args", args, true));
+    EXPECT_EQ(args.back(), "last");
+    ASSERT_TRUE(_read_response_file("response_cached.args", args, true));
+    EXPECT_EQ(args.back(), "last");
+
+    remove("response_small.args.fire-cache");
+    write_file("response_small.args", "a b");
+    ASSERT_TRUE(_read_response_file("response_small.args", args, true));
+    EXPECT_FALSE(ifstream("response_small.args.fire-cache").good()); // Not worth a cache
+    EXPECT_FALSE(_read_response_file("nonexistent.args", args, true));
+    remove("response_cached.args.fire-cache");
+}
+
+string argv_fd(const vector<string> &args, size_t truncate = 0) {
+    string data;
+    for(const string &a: args) {
+        for(int i = 0; i < 4; ++i)
+            data += (char) ((a.size() >> (8 * i)) & 0xff);
+        data += a;
+    }
+    write_file("argv_fd.bin", data.substr(0, data.size() - truncate));
+    return "--fire-argv-fd=" + to_string(open("argv_fd.bin", O_RDONLY));
+}
+
+TEST(matcher, argv_fd) {
+    init_args_no_space({"./run_tests", "-x=1", argv_fd({"a b", "", "-y=\"2\"", string(300, 'z'), "@literal"}), "c"});
+    EXPECT_EQ((int) arg("-x"), 1);
+    EXPECT_EQ((string) arg("-y"), "\"2\"");
+    vector<string> all = arg::vector();
+    EXPECT_EQ(all, vector<string>({"a b", "", string(300, 'z'), "@literal", "c"}));
+
+    init_args_no_space({"./run_tests", argv_fd({})});
+    EXPECT_EQ(fire::_::matcher.pos_args(), 0u);
+
+    EXPECT_EXIT_FAIL(init_args_no_space({"./run_tests", argv_fd({"abc"}, 1)}));
+    EXPECT_EXIT_FAIL(init_args_no_space({"./run_tests", "--fire-argv-fd=x"}));
+    EXPECT_EXIT_FAIL(init_args_no_space({"./run_tests", "--fire-argv-fd=1000000"}));
+}
+#endif
+
+TEST(matcher, config_file) {
+    write_file("config.conf", "# comment\n\n  int = 1\nstring= 'a b' \nflag\nx=2\r\n--overridden = 3\n");
+    init_args({"./run_tests", "--fire-config=config.conf", "--overridden", "4"});
+    EXPECT_EQ((int) arg("--int"), 1);
+    EXPECT_EQ((string) arg("--string"), "a b");
+    EXPECT_TRUE((bool) arg("--flag"));
+    EXPECT_EQ((int) arg("-x"), 2);
+    EXPECT_EQ((int) arg("--overridden"), 4); // Command line takes precedence
+    EXPECT_FALSE((bool) arg("--missing"));
+
+    init_args_strict({"./run_tests", "--fire-config", "config.conf"}, 1);
+    EXPECT_EXIT_FAIL((void) (int) arg("--int")); // Other configured arguments are unknown
+
+    write_file("config_invalid.conf", "-ab = 1");
+    EXPECT_EXIT_FAIL(init_args({"./run_tests", "--fire-config=config_invalid.conf"}));
+    write_file("config_duplicate.conf", "x = 1\n-x = 2");
+    EXPECT_EXIT_FAIL(init_args({"./run_tests", "--fire-config=config_duplicate.conf"}));
+    EXPECT_EXIT_FAIL(init_args({"./run_tests", "--fire-config=nonexistent.conf"}));
+    EXPECT_EXIT_FAIL(init_args({"./run_tests", "--fire-config"}));
+}
+
 TEST(matcher, no_space_assignment) {
     init_args_no_space({"./run_tests"});
     init_args_no_space({"./run_tests", "0"});
@@ -275,6 +457,44 @@ TEST(matcher, no_space_assignment) {
     EXPECT_EXIT_FAIL((void) (int) arg("-x"));
 }
 
+double parse_seconds(size_t n, bool forward) { // Best of three parses of n named and n positional arguments
+    vector<string> args = {"./run_tests"};
+    for(size_t i = 0; i < n; ++i)
+        args.push_back("--option" + to_string(i) + "=" + to_string(i));
+    for(size_t i = 0; i < n; ++i)
+        args.push_back(to_string(i));
+
+    double best = numeric_limits<double>::max();
+    for(int run = 0; run < 3; ++run) {
+        auto start = chrono::steady_clock::now();
+        size_t queried = forward ? n / 2 : n;
+        init_args(args, false, true, (int) queried + 1); // Final check is done by the last conversion
+        for(size_t i = 0; i < queried; ++i)
+            EXPECT_EQ((size_t) (int) arg(("--option" + to_string(i)).c_str()), i);
+        if(forward) {
+            fire::rest r = arg::unconsumed();
+            EXPECT_EQ(r.size(), n - queried + n);
+        } else {
+            vector<int> all = arg::vector();
+            EXPECT_EQ(all.size(), n);
+        }
+        best = min(best, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+TEST(matcher, DISABLED_linear_scaling) { // Timing dependent, so run on demand with ctest -C scaling
+    // Each size is 4x the previous one, so a quadratic algorithm would take 16x longer
+    for(bool forward: {false, true}) {
+        double previous = parse_seconds(1000, forward);
+        for(size_t n: {4000, 16000, 64000}) {
+            double seconds = parse_seconds(n, forward);
+            EXPECT_LT(seconds, 8 * previous) << "n=" << n << " forward=" << forward;
+            previous = seconds;
+        }
+    }
+}
+
 
 TEST(help, help_invocation) {
     EXPECT_EXIT_SUCCESS(init_args_strict({"./run_tests", "-h"}, 0));
@@ -415,6 +635,232 @@ TEST(arg, all_positional_parsing) {
     EXPECT_EQ(all2, vector<std::string>({"text"}));
 }
 
+TEST(arg, environment) {
+    set_env("FIRE_TEST_INT", "2");
+    set_env("FIRE_TEST_STRING", "from env");
+    set_env("FIRE_TEST_INVALID", "x");
+
+    init_args_no_space({"./run_tests", "-i=1", "3"});
+    EXPECT_EQ((int) arg({"-i", "$FIRE_TEST_INT"}), 1); // Command line takes precedence
+    EXPECT_EQ((int) arg({"--int", "$FIRE_TEST_INT"}), 2);
+    EXPECT_EQ((int) arg({0, "$FIRE_TEST_INT"}), 3);
+    EXPECT_EQ((int) arg({1, "$FIRE_TEST_INT"}), 2);
+    EXPECT_EQ((string) arg({"--string", "$FIRE_TEST_STRING"}, "default"), "from env");
+    EXPECT_EQ((string) arg({"--unset", "$FIRE_TEST_UNSET"}, "default"), "default");
+    EXPECT_EQ((string) arg({"--descr", "$ description"}, "default"), "default");
+    fire::optional<int> unset = arg({"--optional", "$FIRE_TEST_UNSET"});
+    EXPECT_FALSE(unset.has_value());
+
+    EXPECT_EXIT_FAIL((void) (int) arg({"--invalid", "$FIRE_TEST_INVALID"}));
+    EXPECT_EXIT_FAIL((void) (bool) arg({"--flag", "$FIRE_TEST_INT"}));
+    EXPECT_EXIT_FAIL(arg({"--twice", "$FIRE_TEST_INT", "$FIRE_TEST_STRING"}));
+
+    init_args_strict({"./run_tests"}, 1);
+    EXPECT_EXIT_FAIL((void) (int) arg({"--invalid", "$FIRE_TEST_INVALID"}));
+}
+
+TEST(arg, stdin_vector) {
+    init_args_no_space({"./run_tests"});
+
+    write_file("stdin.txt", "1\n2\n3");
+    ASSERT_TRUE(reopen_stdin("stdin.txt"));
+    vector<int> all0 = arg::stdin_vector();
+    EXPECT_EQ(all0, vector<int>({1, 2, 3}));
+
+    write_file("stdin.txt", string("a b\0\0c\0", 7));
+    ASSERT_TRUE(reopen_stdin("stdin.txt"));
+    fire::stream<string> items = arg::stdin_vector("description", '\0');
+    EXPECT_EQ(vector<string>(items.begin(), items.end()), vector<string>({"a b", "", "c"}));
+
+    string large; // Items span several chunks
+    for(int i = 0; i < 100000; ++i)
+        large += to_string(i) + "\n";
+    write_file("stdin.txt", large);
+    ASSERT_TRUE(reopen_stdin("stdin.txt"));
+    fire::stream<int> numbers = arg::stdin_vector();
+    int expected = 0;
+    for(int x: numbers)
+        EXPECT_EQ(x, expected++);
+    EXPECT_EQ(expected, 100000);
+}
+
+TEST(arg, stdin_vector_errors) {
+    write_file("stdin.txt", "1\nx\n");
+    ASSERT_TRUE(reopen_stdin("stdin.txt"));
+
+    init_args_no_space_strict({"./run_tests"}, 1);
+    fire::stream<int> numbers = arg::stdin_vector(); // Final check passes, as nothing is read yet
+    auto it = numbers.begin();
+    EXPECT_EQ(*it, 1);
+    EXPECT_EXIT_FAIL(++it);
+
+    auto run = [](const vector<string> &args) { // Stream is converted after -x, as GCC evaluates default arguments
+        init_args_strict(args, 2);
+        int x = arg("-x");
+        fire::stream<string> lines = arg::stdin_vector();
+        (void) x;
+    };
+    EXPECT_EXIT(run({"./run_tests", "stray", "--help"}), ::testing::ExitedWithCode(0), "Usage");
+    EXPECT_EXIT(run({"./run_tests", "-x=abc", "stray"}), ::testing::ExitedWithCode(fire::_failure_code),
+                "^Error: positional arguments given, but not accepted");
+}
+
+TEST(arg, positional_stream) {
+    init_args_no_space({"./run_tests", "0", "1", "x"});
+    fire::stream<int> numbers = arg::vector();
+    auto it = numbers.begin();
+    EXPECT_EQ(*it, 0);
+    EXPECT_EQ(*++it, 1);
+    EXPECT_EXIT_FAIL(++it); // Conversion error is detected only when reached
+
+    init_args_no_space_strict({"./run_tests", "a", "b"}, 1);
+    fire::stream<string> strings = arg::vector();
+    EXPECT_EQ(vector<string>(strings.begin(), strings.end()), vector<string>({"a", "b"}));
+
+    init_args_no_space_strict({"./run_tests", "0"}, 2);
+    fire::stream<int> all = arg::vector();
+    EXPECT_EXIT_FAIL((void) (int) arg(0));
+
+    init_args_no_space_strict({"./run_tests", "0"}, 2);
+    (void) (int) arg(0);
+    EXPECT_EXIT_FAIL(fire::stream<int> all = arg::vector());
+}
+
+#ifdef FIRE_POSIX_
+TEST(arg, path_vector) {
+    (void) system("rm -rf paths && mkdir -p paths/b/c paths/empty");
+    write_file("paths/a.txt", "");
+    write_file("paths/b/x.txt", "");
+    write_file("paths/b/c/y.csv", "");
+    write_file("paths/z.csv", "");
+
+    init_args_no_space({"./run_tests", "paths/b", "paths/*.csv", "nonexistent", "paths/empty"});
+    vector<string> all = arg::path_vector();
+    EXPECT_EQ(all, vector<string>({"paths/b/c/y.csv", "paths/b/x.txt", "paths/z.csv", "nonexistent"}));
+
+    init_args_no_space({"./run_tests", "paths/"});
+    fire::stream<string> files = arg::path_vector();
+    EXPECT_EQ(vector<string>(files.begin(), files.end()),
+              vector<string>({"paths/a.txt", "paths/b/c/y.csv", "paths/b/x.txt", "paths/z.csv"}));
+
+    init_args_no_space({"./run_tests", "paths/*"});
+    vector<string> literal = arg::vector();
+    EXPECT_EQ(literal, vector<string>({"paths/*"}));
+
+    init_args_no_space({"./run_tests", "paths/*.none"});
+    EXPECT_EXIT_FAIL(vector<string> none = arg::path_vector());
+}
+#endif
+
+vector<string> rest_strings(const fire::rest &r) {
+    EXPECT_EQ(r.argv()[r.size()], nullptr);
+    return vector<string>(r.begin(), r.end());
+}
+
+TEST(arg, unconsumed) {
+    vector<string> args = {"./wrapper", "-v", "--opt=1", "-ab", "input", "--", "-c", "x"};
+    init_args(args, false, true, 3);
+    (void) (bool) arg("-v");
+    (void) (string) arg(0);
+    fire::rest r = arg::unconsumed();
+    EXPECT_EQ(rest_strings(r), vector<string>({"--opt=1", "-ab", "--", "-c", "x"}));
+    EXPECT_EQ(r[0], args[2].c_str()); // Original argv entries are forwarded
+
+    args = {"./wrapper", "-n", "3", "--other", "value", "--", "cmd", "--x"};
+    init_args(args, true, true, 2);
+    (void) (int) arg("-n");
+    fire::rest space = arg::unconsumed();
+    EXPECT_EQ(rest_strings(space), vector<string>({"--other", "value", "--", "cmd", "--x"}));
+
+    args = {"./wrapper", "-n", "3", "--", "cmd", "--x"};
+    init_args(args, true, true, 2);
+    (void) (int) arg("-n");
+    fire::rest command = arg::unconsumed();
+    EXPECT_EQ(rest_strings(command), vector<string>({"cmd", "--x"}));
+
+    write_file("forward.txt", "--child=1 child_input");
+    args = {"./wrapper", "@forward.txt", "-n=2"};
+    init_args(args, false, true, 2, true);
+    (void) (int) arg("-n");
+    fire::rest expanded = arg::unconsumed();
+    EXPECT_EQ(rest_strings(expanded), vector<string>({"--child=1", "child_input"}));
+
+    args = {"./wrapper", "-va"};
+    init_args(args, false, true, 2);
+    (void) (bool) arg("-v");
+    EXPECT_EXIT_FAIL(fire::rest partial = arg::unconsumed()); // Part of "-va" can't be forwarded
+
+    args = {"./wrapper", "-v", "--define=a", "--define=b", "-v"};
+    init_args(args, false, true, 2);
+    EXPECT_EXIT({ (void) (bool) arg("-v"); fire::rest r = arg::unconsumed(); }, ::testing::ExitedWithCode(fire::_failure_code),
+                "multiple occurrences of argument -v");
+    args.pop_back();
+    init_args(args, false, true, 2);
+    (void) (bool) arg("-v");
+    fire::rest repeated = arg::unconsumed(); // Repeated arguments of the child are all forwarded
+    EXPECT_EQ(rest_strings(repeated), vector<string>({"--define=a", "--define=b"}));
+
+    args = {"./wrapper", "-n", "3", "input"};
+    init_args(args, true, true, 1);
+    EXPECT_EXIT_FAIL((void) (int) arg("-n"));
+
+    init_args({"./wrapper"});
+    EXPECT_EXIT_FAIL(fire::rest non_strict = arg::unconsumed());
+
+    init_args_strict({"./wrapper", "--help"}, 1);
+    EXPECT_EXIT(fire::rest r = arg::unconsumed("Child command"), ::testing::ExitedWithCode(0), "\\[ARGS\\.\\.\\.\\] +Child command");
+}
+
+vector<int> shard_of(const vector<string> &args) {
+    init_args_no_space(args);
+    return arg::vector();
+}
+
+TEST(arg, shard) {
+    vector<string> args = {"./run_tests", "0", "1", "2", "3", "4", "5", "6"};
+    auto with = [&args](const string &option) {
+        vector<string> sharded = args;
+        sharded.insert(sharded.begin() + 1, option);
+        return sharded;
+    };
+    EXPECT_EQ(shard_of(with("--fire-shard=0/3")), vector<int>({0, 1}));
+    EXPECT_EQ(shard_of(with("--fire-shard=2/3:contiguous")), vector<int>({4, 5, 6}));
+    EXPECT_EQ(shard_of(with("--fire-shard=1/3:strided")), vector<int>({1, 4}));
+    EXPECT_EQ(shard_of(with("--fire-shard=0/1:hash")), vector<int>({0, 1, 2, 3, 4, 5, 6}));
+
+    vector<int> all;
+    for(int i = 0; i < 3; ++i) {
+        vector<int> shard = shard_of(with("--fire-shard=" + to_string(i) + "/3:hash"));
+        all.insert(all.end(), shard.begin(), shard.end());
+    }
+    sort(all.begin(), all.end());
+    EXPECT_EQ(all, vector<int>({0, 1, 2, 3, 4, 5, 6})); // Shards are disjoint and complete
+
+    init_args_no_space(with("--fire-shard=1/2:strided"));
+    fire::stream<int> stream = arg::vector();
+    EXPECT_EQ(vector<int>(stream.begin(), stream.end()), vector<int>({1, 3, 5}));
+
+    set_env("FIRE_SHARD", "1/2");
+    EXPECT_EQ(shard_of(args), vector<int>({3, 4, 5, 6}));
+    EXPECT_EQ(shard_of(with("--fire-shard=0/7")), vector<int>({0})); // Command line takes precedence
+    set_env("FIRE_SHARD", "bogus");
+    EXPECT_EXIT_FAIL(shard_of(args));
+    init_args_no_space({"./run_tests", "-x=1"}); // Only read for vector arguments
+    EXPECT_EQ((int) arg("-x"), 1);
+    unset_env("FIRE_SHARD");
+
+    EXPECT_EXIT_FAIL(shard_of(with("--fire-shard=3/3")));
+    EXPECT_EXIT_FAIL(shard_of(with("--fire-shard=0/0")));
+    EXPECT_EXIT_FAIL(shard_of(with("--fire-shard=0/2:random")));
+    EXPECT_EXIT_FAIL(shard_of(with("--fire-shard")));
+
+    init_args_strict({"./run_tests", "-x", "1", "--fire-shard=0/2"}, 1); // Nothing to shard
+    EXPECT_EXIT((void) (int) arg("-x"), ::testing::ExitedWithCode(fire::_failure_code), "invalid argument --fire-shard");
+    init_args_no_space_strict(with("--fire-shard=0/3"), 1);
+    vector<int> strict = arg::vector();
+    EXPECT_EQ(strict, vector<int>({0, 1}));
+}
+
 TEST(arg, double_dash_separator) {
     init_args_no_space({"./run_tests", "--"});
     vector<string> all0 = arg::vector();
@@ -503,6 +949,76 @@ TEST(arg, strict_query_all_positional) {
     EXPECT_EXIT_FAIL(vector<int> all2 = arg::vector());
 }
 
+TEST(arg, string_ref) {
+    write_file("query.sql", "SELECT 1;\n");
+    write_file("empty.sql", "");
+    init_args({"./run_tests", "--file=@query.sql", "--empty=@empty.sql", "--literal=abc", "--escaped=@@abc", "--at=@"});
+
+    string_ref file = arg("--file");
+    EXPECT_EQ(file.str(), "SELECT 1;\n");
+    EXPECT_EQ(file.size(), 10u);
+    string_ref copy = file;
+    EXPECT_EQ(string(copy.begin(), copy.end()), "SELECT 1;\n");
+    EXPECT_TRUE(((string_ref) arg("--empty")).empty());
+    EXPECT_EQ(((string_ref) arg("--literal")).str(), "abc");
+    EXPECT_EQ(((string_ref) arg("--escaped")).str(), "@abc");
+    EXPECT_EQ(((string_ref) arg("--at")).str(), "@");
+    EXPECT_EQ(((string_ref) arg("--default", "@query.sql")).str(), "@query.sql"); // Defaults are literal
+
+    init_args({"./run_tests", "--file", "@query.sql", "-e", "@empty.sql"});
+    EXPECT_EQ(((string_ref) arg("--file")).str(), "SELECT 1;\n");
+    EXPECT_TRUE(((string_ref) arg("-e")).empty());
+    init_args_response_files({"./run_tests", "--file", "@query.sql"}, true);
+    EXPECT_EQ(((string_ref) arg("--file")).str(), "SELECT 1;\n"); // Not a response file
+
+    init_args({"./run_tests", "--file=@nonexistent.sql", "--flag"});
+    EXPECT_EXIT_FAIL((void) (string_ref) arg("--file"));
+    EXPECT_EXIT_FAIL((void) (string_ref) arg("--flag"));
+    EXPECT_EXIT_FAIL((void) (string_ref) arg("--missing"));
+}
+
+#ifdef FIRE_POSIX_
+TEST(arg, string_ref_limit) {
+    {
+        ofstream big("big.sql", ios::binary); // Sparse, so it takes no disk space
+        big.seekp((streamoff) fire::_max_value_file_size);
+        big.put('\n');
+    }
+    init_args({"./run_tests", "--file=@big.sql"});
+    EXPECT_EXIT((void) (string_ref) arg("--file"), ::testing::ExitedWithCode(fire::_failure_code), "big.sql .* is too large");
+    remove("big.sql");
+
+    int fds[2]; // Pipes have no size, so reading stops at the limit
+    ASSERT_EQ(pipe(fds), 0);
+    ASSERT_EQ(write(fds[1], string(1000, 'x').data(), 1000), 1000);
+    close(fds[1]);
+    fire::_file_view piped("/dev/fd/" + to_string(fds[0]), 100);
+    close(fds[0]);
+    EXPECT_TRUE(piped.too_large());
+    EXPECT_FALSE(piped.valid());
+}
+#endif
+
+TEST(arg, mapped_file) {
+    write_file("input.txt", "line 1\nline 2\n");
+    write_file("empty.txt", "");
+    init_args({"./run_tests", "--input=input.txt", "--empty=empty.txt", "--dir=.", "--missing=nonexistent.txt"});
+
+    mapped_file input = arg("--input");
+    EXPECT_EQ(input.path(), "input.txt");
+    EXPECT_EQ(string(input.begin(), input.end()), "line 1\nline 2\n");
+    mapped_file copy = input;
+    EXPECT_EQ(copy.data(), input.data());
+    (void) input.advise(advice::random);
+    EXPECT_TRUE(((mapped_file) arg("--empty")).empty());
+    EXPECT_EQ(((mapped_file) arg("--default", "input.txt")).size(), 14u);
+    EXPECT_TRUE(mapped_file().empty());
+
+    EXPECT_EXIT_FAIL((void) (mapped_file) arg("--dir"));
+    EXPECT_EXIT_FAIL((void) (mapped_file) arg("--missing"));
+    EXPECT_EXIT_FAIL((void) (mapped_file) arg("--undefined"));
+}
+
 TEST(arg, optional_arguments) {
     init_args({"./run_tests", "-i", "1", "-f", "1.0", "-s", "test"});
 
@@ -548,3 +1064,378 @@ TEST(arg, negative) {
     EXPECT_EQ((int) arg(0), -10);
     EXPECT_EQ((int) arg("-a"), -20);
 }
+
+
+TEST(split_arguments, quotes) {
+    EXPECT_EQ(_split_arguments(""), vector<string>());
+    EXPECT_EQ(_split_arguments(" -x=1\n\t--name  abc "), vector<string>({"-x=1", "--name", "abc"}));
+    EXPECT_EQ(_split_arguments("--name='a b' \"c d\"e '' 'x'\"y\" \"unterminated"),
+              vector<string>({"--name=a b", "c de", "", "xy", "unterminated"}));
+}
+
+struct knobs {
+    int threads;
+    string name;
+};
+
+TEST(reloadable, reload) {
+    init_args({"./run_tests", "-x", "1"});
+    auto parse = [] { return knobs{(int) arg("--threads", 1), (string) arg("--name", "")}; };
+
+    write_file("reloadable.args", "--threads=2 --name 'a b'");
+    reloadable<knobs> opts("reloadable.args", parse);
+    const knobs &first = opts.get();
+    EXPECT_EQ(first.threads, 2);
+    EXPECT_EQ(first.name, "a b");
+    EXPECT_FALSE(opts.reload()); // Unchanged file
+
+    write_file("reloadable.args", "--threads 3");
+    EXPECT_TRUE(opts.reload());
+    EXPECT_EQ(opts.get().threads, 3);
+    EXPECT_EQ(opts.get().name, "");
+    EXPECT_EQ(first.threads, 2); // Previous snapshot stays valid
+
+    write_file("reloadable.args", "--threads=x");
+    EXPECT_FALSE(opts.reload());
+    write_file("reloadable.args", "--undefined=1");
+    EXPECT_FALSE(opts.reload());
+    write_file("reloadable.args", "--threads=4 --fire-argv-fd=0"); // Would read the service's stdin
+    EXPECT_FALSE(opts.reload());
+    EXPECT_EQ(opts.get().threads, 3);
+
+    EXPECT_EQ((int) arg("-x"), 1); // Program's own arguments are unaffected
+
+    EXPECT_EXIT_FAIL(reloadable<knobs>("nonexistent.args", parse));
+    write_file("reloadable.args", "--threads=x");
+    EXPECT_EXIT_FAIL(reloadable<knobs>("reloadable.args", parse));
+    write_file("reloadable.args", "--fire-config=service.conf");
+    EXPECT_EXIT_FAIL(reloadable<knobs>("reloadable.args", parse));
+}
+
+struct counted {
+    static int live;
+    int threads;
+    explicit counted(int threads): threads(threads) { ++live; }
+    counted(const counted &other): threads(other.threads) { ++live; }
+    ~counted() { --live; }
+};
+
+int counted::live = 0;
+
+TEST(reloadable, snapshots) {
+    init_args({"./run_tests"});
+    write_file("reloadable.args", "--threads=0");
+    {
+        reloadable<counted> opts("reloadable.args", [] { return counted((int) arg("--threads")); }, true, 3);
+        for(int i = 1; i <= 10; ++i) {
+            write_file("reloadable.args", "--threads=" + to_string(i));
+            EXPECT_TRUE(opts.reload());
+            EXPECT_EQ(opts.get().threads, i);
+            EXPECT_LE(counted::live, 3); // Older snapshots are freed
+        }
+    }
+    EXPECT_EQ(counted::live, 0);
+}
+
+struct forwarding {
+    bool verbose;
+    fire::rest child;
+};
+
+TEST(reloadable, rest) {
+    init_args({"./run_tests"});
+    auto parse = [] {
+        bool verbose = arg("-v");
+        fire::rest child = arg::unconsumed();
+        return forwarding{verbose, child};
+    };
+    write_file("reloadable.args", "-v --define=a -- ./child input");
+    reloadable<forwarding> opts("reloadable.args", parse);
+    write_file("reloadable.args", "overwritten"); // Forwarded arguments are owned by the snapshot
+    EXPECT_TRUE(opts.get().verbose);
+    EXPECT_EQ(rest_strings(opts.get().child), vector<string>({"--define=a", "--", "./child", "input"}));
+}
+
+TEST(reloadable, concurrent_stream) {
+    vector<string> args = {"./run_tests"};
+    for(int i = 0; i < 20000; ++i)
+        args.push_back(to_string(i));
+    init_args_no_space_strict(args, 1);
+    fire::stream<int> numbers = arg::vector();
+
+    write_file("reloadable.args", "--threads=0");
+    auto parse = [] { return knobs{(int) arg("--threads", 1), (string) arg("--name", "")}; };
+    reloadable<knobs> opts("reloadable.args", parse);
+    thread reloader([&opts] { // Reloads don't touch the program's own matcher, which the stream reads
+        for(int i = 1; i <= 100; ++i) {
+            write_file("reloadable.args", "--threads=" + to_string(i));
+            opts.reload();
+        }
+    });
+    int expected = 0;
+    for(int x: numbers)
+        EXPECT_EQ(x, expected++);
+    reloader.join();
+    EXPECT_EQ(expected, 20000);
+    EXPECT_EQ(opts.get().threads, 100);
+}
+
+TEST(help_logger, completion) {
+    write_file("in.txt", "");
+    init_args({"./bin/my-tool"});
+    (void) (int) arg({"-n", "--count", "Number of items"}, 1);
+    (void) (bool) arg({"-v", "Verbose"});
+    (void) (mapped_file) arg({"--input", "Input file"}, "in.txt");
+
+    string bash = fire::_::help_logger.completion("bash");
+    EXPECT_NE(bash.find("complete -o filenames -F _fire_my_tool my-tool"), string::npos);
+    EXPECT_NE(bash.find("--input) COMPREPLY=($(compgen -f -- \"$cur\"))"), string::npos);
+    EXPECT_NE(bash.find("-n|--count) COMPREPLY=()"), string::npos);
+    EXPECT_EQ(bash.find("compgen -f -- \"$cur\"))\n    fi"), string::npos); // No positional arguments
+
+    string zsh = fire::_::help_logger.completion("zsh");
+    EXPECT_NE(zsh.find("'(-n --count)'{-n=,--count=}'[Number of items]:INTEGER: '"), string::npos);
+    EXPECT_NE(zsh.find("'--input=[Input file]:PATH:_files'"), string::npos);
+    EXPECT_NE(zsh.find("'-v[Verbose]'"), string::npos);
+
+    string fish = fire::_::help_logger.completion("fish");
+    EXPECT_NE(fish.find("complete -c my-tool -f\n"), string::npos);
+    EXPECT_NE(fish.find("complete -c my-tool -s n -l count -x -d 'Number of items'"), string::npos);
+    EXPECT_NE(fish.find("complete -c my-tool -l input -r -F -d 'Input file'"), string::npos);
+
+    EXPECT_EXIT_FAIL(fire::_::help_logger.completion("tcsh"));
+    init_args_strict({"./run_tests", "--fire-completion=fish", "--undefined"}, 1);
+    EXPECT_EXIT((void) (int) arg("-x"), ::testing::ExitedWithCode(0), "");
+}
+
+TEST(help_logger, complete) {
+    init_args_strict({"./run_tests", "--fire-complete", "2", "prog", "--count=1", "-"}, 1000);
+    fire::optional<int> count = arg({"-n", "--count"});
+    (void) (bool) arg({"-v", "--verbose"});
+    (void) (string) arg({"--name"}, "x");
+    EXPECT_FALSE(count.has_value()); // Command line isn't parsed when completing
+
+    auto complete = [](size_t index, const vector<string> &words) {
+        return fire::_::help_logger.complete(index, words, true);
+    };
+    EXPECT_EQ(complete(1, {"prog", "--"}), vector<string>({"--count", "--help", "--name", "--verbose"}));
+    EXPECT_EQ(complete(1, {"prog", "--", "-n=1"}), vector<string>({"--help", "--name", "--verbose"}));
+    EXPECT_EQ(complete(2, {"prog", "--count=1", "-"}), vector<string>({"--help", "--name", "--verbose", "-h", "-v"}));
+    EXPECT_EQ(complete(2, {"prog", "-v", "--v"}), vector<string>({}));
+    EXPECT_EQ(complete(2, {"prog", "--name", "-"}), vector<string>({})); // Value of --name
+    EXPECT_EQ(complete(1, {"prog", "--name="}), vector<string>({}));
+    EXPECT_EQ(complete(1, {"prog"}), vector<string>({}));
+
+    init_args_strict({"./run_tests", "--fire-complete", "1", "prog", "-"}, 1);
+    EXPECT_EXIT((void) (int) arg("-x"), ::testing::ExitedWithCode(0), "");
+    EXPECT_EXIT_FAIL(init_args_strict({"./run_tests", "--fire-complete", "x", "prog"}, 1));
+}
+
+TEST(help_logger, schema) {
+    init_args_no_space({"./bin/tool", "0"});
+    (void) (int) arg({0, "<count>", "Item \"count\""});
+    (void) (double) arg({"-r", "--rate", "$TOOL_RATE"}, 0.5);
+    (void) (bool) arg({"-v"});
+    vector<double> values = arg::vector("Values");
+
+    string schema = fire::_::help_logger.schema(false, false);
+    EXPECT_NE(schema.find("\"program\": \"tool\",\n  \"space_assignment\": false,\n  \"response_files\": false"), string::npos);
+    EXPECT_NE(schema.find("{\"short\": null, \"long\": null, \"position\": 0, \"positional_name\": \"<count>\", "
+                          "\"description\": \"Item \\\"count\\\"\", \"type\": \"INTEGER\", \"min\": -2147483648, "
+                          "\"max\": 2147483647, \"default\": null, "
+                          "\"optional\": false, \"env\": null}"), string::npos);
+    EXPECT_NE(schema.find("{\"short\": \"-r\", \"long\": \"--rate\", \"position\": null, \"positional_name\": null, "
+                          "\"description\": \"\", \"type\": \"REAL\", \"min\": -1.79769313486231570"), string::npos);
+    EXPECT_NE(schema.find("e+308, \"default\": \"0.500000\", \"optional\": true, \"env\": \"TOOL_RATE\"}"), string::npos);
+    EXPECT_NE(schema.find("\"type\": \"FLAG\", \"min\": null, \"max\": null"), string::npos);
+    EXPECT_NE(schema.find("\"type\": \"FLAG\""), string::npos);
+    EXPECT_NE(schema.find("\"vector\": {\"description\": \"Values\", \"type\": \"REAL\", \"source\": \"positional\"}"),
+              string::npos);
+    EXPECT_NE(schema.find("\"rest\": null"), string::npos);
+
+    vector<string> forwarding = {"./tool", "-v"}; // Outlives the matcher, which points to its entries like to argv
+    init_args_strict(forwarding, 2);
+    (void) (bool) arg("-v");
+    fire::rest child = arg::unconsumed("Child command");
+    schema = fire::_::help_logger.schema(true, false);
+    EXPECT_NE(schema.find("\"vector\": null,\n  \"rest\": {\"description\": \"Child command\"}"), string::npos);
+    EXPECT_EQ(schema.find("Child command\", \"type\""), string::npos); // Not listed as an argument or vector
+
+    init_args_strict({"./run_tests", "--fire-schema", "--undefined"}, 1);
+    EXPECT_EXIT((void) (int) arg("-x"), ::testing::ExitedWithCode(0), "");
+}
+
+TEST(validator, schema) {
+    init_args({"./bin/tool", "-n=1"});
+    (void) (int) arg({"-n", "--count"});
+    (void) (double) arg({"-r", "--rate", "$TOOL_RATE"}, 0.5);
+    fire::optional<string> name = arg({"--name", "Name \"quoted\""});
+    (void) (bool) arg({"-v"});
+    validator named(fire::_::help_logger.schema(true, false));
+
+    EXPECT_FALSE(named.validate({"-n", "1"}).has_value());
+    EXPECT_FALSE(named.validate({"--count=1", "-r", "2.5", "--name", "x", "-v"}).has_value());
+    EXPECT_EQ(named.validate({}).value_or(""), "required argument --count not provided");
+    EXPECT_EQ(named.validate({"-n", "x"}).value_or(""), "value x is not an integer");
+    EXPECT_EQ(named.validate({"-n", "1", "-v", "1"}).value_or(""), "flag -v must not have value");
+    EXPECT_EQ(named.validate({"-n", "1", "--undefined"}).value_or(""), "invalid argument --undefined");
+    EXPECT_FALSE(named.validate({"-n", "1"}).has_value());
+    EXPECT_EQ(named.validate({"-n", "1", "0"}).value_or(""), "positional arguments given, but not accepted");
+    EXPECT_TRUE(named.validate({"@args.txt"}).has_value());
+    EXPECT_FALSE(named.validate({"-n", "1", "--name", "@alice"}).has_value());
+    validator expanding(fire::_::help_logger.schema(true, true));
+    EXPECT_EQ(expanding.validate({"-n", "1", "@args.txt"}).value_or(""), "argument @args.txt reads files, so it can't be validated");
+    EXPECT_FALSE(expanding.validate({"-n", "1", "--name", "@alice"}).has_value());
+    EXPECT_TRUE(named.validate({"--fire-config=tool.conf"}).has_value());
+    for(const string &reserved: vector<string>{"--fire-complete", "--fire-schema", "--fire-completion=bash", "--fire-shard=0/2"})
+        EXPECT_EQ(named.validate({"-n", "1", reserved}).value_or(""), "reserved argument " + reserved + " can't be validated");
+    EXPECT_EQ(fire::_::matcher.get_executable(), "./bin/tool"); // Program's own arguments are kept
+
+    init_args_no_space({"./tool"});
+    vector<double> values = arg::vector();
+    validator positional(fire::_::help_logger.schema(false, false));
+    EXPECT_FALSE(positional.validate({"1", "2.5", "-3"}).has_value());
+    EXPECT_FALSE(positional.validate({}).has_value());
+    EXPECT_EQ(positional.validate({"1", "x"}).value_or(""), "value x is not a real number");
+    set_env("FIRE_SHARD", "bogus"); // Gateway's own environment doesn't apply
+    EXPECT_FALSE(positional.validate({"1", "2"}).has_value());
+    unset_env("FIRE_SHARD");
+
+    init_args_no_space_strict({"./tool"}, 1);
+    fire::stream<string> lines = arg::stdin_vector("Lines");
+    string stdin_schema = fire::_::help_logger.schema(false, false);
+    EXPECT_NE(stdin_schema.find("\"vector\": {\"description\": \"Lines\", \"type\": \"STRING\", \"source\": \"stdin\"}"),
+              string::npos);
+    validator from_stdin(stdin_schema);
+    EXPECT_FALSE(from_stdin.validate({}).has_value());
+    EXPECT_EQ(from_stdin.validate({"pos"}).value_or(""), "invalid positional argument 0");
+    init_args_no_space_strict({"./tool", "pos"}, 1); // Same as the program
+    EXPECT_EXIT(fire::stream<string> s = arg::stdin_vector(), ::testing::ExitedWithCode(fire::_failure_code),
+                "invalid positional argument 0");
+
+    init_args_no_space({"./tool"});
+    fire::stream<string> paths = arg::path_vector();
+    validator from_paths(fire::_::help_logger.schema(false, false));
+    EXPECT_FALSE(from_paths.validate({"*.txt", "missing_directory"}).has_value()); // Not expanded
+
+    std::atomic<int> wrong(0); // Validations may run on several threads
+    vector<thread> threads;
+    for(int t = 0; t < 4; ++t)
+        threads.emplace_back([&positional, &wrong, t] {
+            for(int i = 0; i < 200; ++i) {
+                bool valid = (i + t) % 2 == 0;
+                wrong += positional.validate({"1", valid ? "2" : "x"}).has_value() == valid;
+            }
+        });
+    for(thread &t: threads)
+        t.join();
+    EXPECT_EQ(wrong, 0);
+
+    init_args_strict({"./tool"}, 2);
+    (void) (bool) arg("-v");
+    fire::rest child = arg::unconsumed();
+    validator forwarding(fire::_::help_logger.schema(true, false));
+    EXPECT_FALSE(forwarding.validate({"-v", "--", "./child", "--threads=4", "input"}).has_value());
+    EXPECT_FALSE(forwarding.validate({"--undefined", "input"}).has_value()); // Forwarded to the child
+    EXPECT_EQ(forwarding.validate({"-v=1"}).value_or(""), "flag -v must not have value");
+
+    init_args_strict({"./tool", "-x", "1"}, 2);
+    (void) (unsigned char) arg("-x");
+    (void) (float) arg("-r", 0.5);
+    validator ranged(fire::_::help_logger.schema(true, false)); // Same bounds as the program's own types
+    EXPECT_FALSE(ranged.validate({"-x", "255"}).has_value());
+    EXPECT_EQ(ranged.validate({"-x", "300"}).value_or(""), "value 300 out of range");
+    EXPECT_EQ(ranged.validate({"-x", "-1"}).value_or(""), "argument -x must be positive");
+    EXPECT_NE(ranged.validate({"-x", "1", "-r", "1e39"}).value_or("").find("out of range"), string::npos);
+
+    EXPECT_EXIT_FAIL(validator("{\"arguments\": [}"));
+    EXPECT_EXIT_FAIL(validator("{\"arguments\": [{\"short\": \"-x\", \"type\": \"INTEGER\", \"default\": \"x\"}]}"));
+}
+
+vector<string> argv_strings(argv_builder &builder) {
+    vector<string> args;
+    char * const *argv = builder.argv();
+    for(size_t i = 0; i < builder.argc(); ++i)
+        args.push_back(argv[i]);
+    EXPECT_EQ(argv[builder.argc()], nullptr);
+    return args;
+}
+
+TEST(argv_builder, build) {
+    argv_builder named("./child");
+    named.add({"-n", "--count"}, 3).add({"-r"}, 0.1).add({"--name"}, string("a b=c")).add({"--unsigned"}, 18446744073709551615ull);
+    named.add({"-v"}, true).add({"--quiet"}, false).add({"--missing"}, fire::optional<int>()).add({"--present"}, fire::optional<int>(-2));
+    EXPECT_EQ(argv_strings(named), vector<string>({"./child", "--count=3", "-r=0.10000000000000001", "--name=a b=c",
+                                                    "--unsigned=18446744073709551615", "-v", "--present=-2"}));
+
+    init_args(argv_strings(named));
+    EXPECT_EQ((int) arg({"-n", "--count"}), 3);
+    EXPECT_EQ((double) arg("-r"), 0.1);
+    EXPECT_EQ((string) arg("--name"), "a b=c");
+    EXPECT_TRUE((bool) arg("-v"));
+
+    argv_builder positional("./child");
+    positional.add({1}, "-x").add({0}, -5).add(arg::vector(), vector<string>({"a", "b"})).add({"-f"}, true);
+    EXPECT_EQ(argv_strings(positional), vector<string>({"./child", "-f", "--", "-5", "-x", "a", "b"}));
+
+    argv_builder numbers("./child");
+    numbers.add({0}, -5).add(arg::vector(), vector<double>({1.5}));
+    EXPECT_EQ(argv_strings(numbers), vector<string>({"./child", "-5", "1.5"}));
+
+    argv_builder handle("./child");
+    handle.add({0}, string("@handle")).add({1}, string("@"));
+    EXPECT_EQ(argv_strings(handle), vector<string>({"./child", "--", "@handle", "@"}));
+    init_args(argv_strings(handle), false, false, 1000000, true); // Child expands response files
+    EXPECT_EQ((string) arg(0), "@handle");
+    EXPECT_EQ((string) arg(1), "@");
+
+    EXPECT_EXIT_FAIL(argv_builder("./child").add({0}, true));
+    EXPECT_EXIT_FAIL(argv_builder("./child").add(arg::vector(), 1));
+}
+
+int sum(int x = arg("-x"), int y = arg("-y", 1)) {
+    return x + y;
+}
+
+FIRE_SUBCOMMAND(sum)
+
+int run_multicall(const vector<string> &args) {
+    vector<const char *> argv;
+    for(const string &a: args)
+        argv.push_back(a.c_str());
+    return fire::_subcommands::run_multicall((int) argv.size(), argv.data());
+}
+
+TEST(subcommands, multicall) {
+    EXPECT_EQ(run_multicall({"sum", "-x=2"}), 3);
+    EXPECT_EQ(run_multicall({"/usr/local/bin/sum", "-x=2", "-y=3"}), 5);
+    EXPECT_EQ(run_multicall({"C:\\tools\\sum.exe", "-x=2"}), 3);
+    EXPECT_EQ(fire::_::matcher.get_executable(), "C:\\tools\\sum.exe");
+
+    EXPECT_EQ(run_multicall({"./tools", "sum", "-x=2"}), 3); // Falls back to the first argument
+    EXPECT_EQ(fire::_::matcher.get_executable(), "./tools sum");
+    EXPECT_EXIT_FAIL(run_multicall({"./tools", "product", "-x=2"}));
+    EXPECT_EXIT_FAIL(run_multicall({"./tools"}));
+    EXPECT_EXIT(run_multicall({"./tools", "--help"}), ::testing::ExitedWithCode(0), "");
+}
+
+TEST(subcommands, completion) {
+    string bash = fire::_subcommands::completion("./bin/tools", "bash"); // Commands only declare their arguments
+    EXPECT_NE(bash.find("_fire_tools_sum() {"), string::npos);
+    EXPECT_NE(bash.find("COMPREPLY=($(compgen -W \"-y -x -h --help\" -- \"$cur\"))"), string::npos);
+    EXPECT_NE(bash.find("COMPREPLY=($(compgen -W \"sum\" -- \"${COMP_WORDS[COMP_CWORD]}\"))"), string::npos);
+    EXPECT_NE(bash.find("        sum) _fire_tools_sum;;\n"), string::npos);
+    EXPECT_NE(bash.find("complete -o filenames -F _fire_tools tools\n"), string::npos);
+
+    string zsh = fire::_subcommands::completion("./bin/tools", "zsh");
+    EXPECT_EQ(zsh.find("#compdef tools\n_fire_tools_sum() {\n    _arguments -s"), 0u);
+    EXPECT_NE(zsh.find("compadd sum\n"), string::npos);
+
+    string fish = fire::_subcommands::completion("./bin/tools", "fish");
+    EXPECT_NE(fish.find("complete -c tools -n __fish_use_subcommand -f -a 'sum'\n"), string::npos);
+    EXPECT_NE(fish.find("complete -c tools -n '__fish_seen_subcommand_from sum' -s x -x -d ''\n"), string::npos);
+
+    EXPECT_EXIT(exit(run_multicall({"./tools", "sum", "--fire-completion=bash"})), ::testing::ExitedWithCode(0), "");
+    EXPECT_EXIT_FAIL(fire::_subcommands::completion("./bin/tools", "tcsh"));
+}
+